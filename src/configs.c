@@ -1,61 +1,26 @@
 #include <pebble.h>
 #include "configs.h"
 #include "keys.h"
-#include "health.h"
+#include "storage.h"
 
 static bool configs_loaded;
-static bool modules_loaded;
 static int configs;
-static uint8_t modules[4];
-static uint8_t modules_sleep[4];
-
-void set_module(int slot, int module, bool sleeping_mode) {
-    if (!sleeping_mode) {
-        modules[slot] = module;
-    } else {
-        modules_sleep[slot] = module;
-    }
-}
 
 int get_wind_speed_unit() {
-    return persist_exists(KEY_SPEEDUNIT) ? persist_read_int(KEY_SPEEDUNIT) : UNIT_MPH;
+    return storage_exists(KEY_SPEEDUNIT) ? storage_read_int(KEY_SPEEDUNIT) : UNIT_MPH;
 }
 
-static void load_modules() {
-    modules[SLOT_A] = persist_read_int(KEY_SLOTA);
-    modules[SLOT_B] = persist_read_int(KEY_SLOTB);
-    modules[SLOT_C] = persist_read_int(KEY_SLOTC);
-    modules[SLOT_D] = persist_read_int(KEY_SLOTD);
-    modules_sleep[SLOT_A] = persist_read_int(KEY_SLEEPSLOTA);
-    modules_sleep[SLOT_B] = persist_read_int(KEY_SLEEPSLOTB);
-    modules_sleep[SLOT_C] = persist_read_int(KEY_SLEEPSLOTC);
-    modules_sleep[SLOT_D] = persist_read_int(KEY_SLEEPSLOTD);
-
-    modules_loaded = true;
+// hours between health record batches, 0 keeps no records
+int get_health_log_interval() {
+    return storage_exists(KEY_HEALTHLOG) ? storage_read_int(KEY_HEALTHLOG) : 0;
 }
 
-bool is_module_enabled(int module) {
-    if (!modules_loaded) {
-        load_modules();
-    }
-    if (should_show_sleep_data()) {
-        for (unsigned int i = 0; i < 4; ++i) {
-            if (modules_sleep[i] == module) {
-                return true;
-            }
-        }
-    } else {
-        for (unsigned int i = 0; i < 4; ++i) {
-            if (modules[i] == module) {
-                return true;
-            }
-        }
-    }
-    return false;
+int get_health_log_records() {
+    return storage_exists(KEY_HEALTHLOGRECORDS) ? storage_read_int(KEY_HEALTHLOGRECORDS) : 0;
 }
 
 static int load_config_toggles() {
-    configs = persist_exists(KEY_CONFIGS) ? persist_read_int(KEY_CONFIGS) : 0;
+    configs = storage_exists(KEY_CONFIGS) ? storage_read_int(KEY_CONFIGS) : 0;
     configs_loaded = true;
     return configs;
 }
@@ -120,23 +85,3 @@ bool is_simple_mode_enabled() {
 bool is_timezone_enabled() {
     return get_config_toggles() & FLAG_TIMEZONES;
 }
-
-int get_slot_for_module(int module) {
-    if (!modules_loaded) {
-        load_modules();
-    }
-    if (should_show_sleep_data()) {
-        for (unsigned int i = 0; i < 4; ++i) {
-            if (modules_sleep[i] == module) {
-                return i;
-            }
-        }
-    } else {
-        for (unsigned int i = 0; i < 4; ++i) {
-            if (modules[i] == module) {
-                return i;
-            }
-        }
-    }
-    return -1;
-}
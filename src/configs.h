@@ -3,10 +3,6 @@
 
 void set_config_toggles(int);
 int get_config_toggles();
-bool is_module_enabled(int);
-int get_slot_for_module(int);
-
-void set_module(int, int, bool);
 
 bool is_weather_toggle_enabled();
 bool is_health_toggle_enabled();
@@ -22,5 +18,7 @@ bool is_simple_mode_enabled();
 bool is_timezone_enabled();
 
 int get_wind_speed_unit();
+int get_health_log_interval();
+int get_health_log_records();
 
 #endif
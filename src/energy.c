@@ -0,0 +1,128 @@
+#include <pebble.h>
+#include "energy.h"
+#include "keys.h"
+
+// What the face makes the watch do, counted since launch, and a cost model
+// turning it into an estimated charge per day. The costs are rough guesses
+// in microamp seconds, per event and per 1000 units of its amount; the phone
+// can send its own with the report request to compare models.
+struct EnergyCost {
+    uint32_t event;
+    uint32_t per_thousand;
+};
+
+static const struct EnergyCost default_costs[ENERGY_EVENTS] = {
+    [ENERGY_MESSAGE_OUT] = { 150, 300 }, // waking the radio, then the airtime
+    [ENERGY_MESSAGE_IN] = { 100, 300 },
+    [ENERGY_HEALTH_QUERY] = { 20, 0 }, // a read of the health database
+    [ENERGY_FLASH_WRITE] = { 50, 100 },
+    [ENERGY_INVALIDATION] = { 5, 3 }, // redrawing the area and updating the display
+    [ENERGY_VIBRATION] = { 0, 60000 }, // about 60 mA for the motor
+    [ENERGY_TICK] = { 0, 5000 }, // about 5 mA over the CPU asleep
+};
+
+static const char *const event_names[ENERGY_EVENTS] = {
+    "messages out", "messages in", "health queries", "flash writes", "invalidations", "vibrations", "tick cpu"
+};
+
+static struct EnergyCost costs[ENERGY_EVENTS];
+static uint32_t counts[ENERGY_EVENTS];
+static uint32_t amounts[ENERGY_EVENTS];
+static time_t counting_since;
+
+void init_energy() {
+    memcpy(costs, default_costs, sizeof(costs));
+    counting_since = time(NULL);
+}
+
+// the pixels overflow after a few months, halving everything and the
+// time counted keeps the rates
+static void halve_counters() {
+    for (int event = 0; event < ENERGY_EVENTS; ++event) {
+        counts[event] /= 2;
+        amounts[event] /= 2;
+    }
+    counting_since += (time(NULL) - counting_since) / 2;
+}
+
+void energy_count(int event, uint32_t amount) {
+    if (amounts[event] + amount < amounts[event]) {
+        halve_counters();
+    }
+    counts[event]++;
+    amounts[event] += amount;
+}
+
+uint32_t energy_begin() {
+    time_t seconds;
+    uint16_t millis;
+    time_ms(&seconds, &millis);
+    return (uint32_t)seconds * 1000 + millis;
+}
+
+void energy_end(int event, uint32_t start) {
+    energy_count(event, energy_begin() - start);
+}
+
+// the event and the per thousand cost of each event, little endian uint32
+void set_energy_costs(const uint8_t *data, uint16_t size) {
+    if (size != ENERGY_EVENTS * 8) {
+        APP_LOG(APP_LOG_LEVEL_WARNING, "Energy costs need %d bytes, got %d", ENERGY_EVENTS * 8, size);
+        return;
+    }
+    for (int i = 0; i < ENERGY_EVENTS * 2; ++i) {
+        const uint8_t *value = &data[i * 4];
+        uint32_t cost = value[0] | value[1] << 8 | value[2] << 16 | (uint32_t)value[3] << 24;
+        if (i % 2 == 0) {
+            costs[i / 2].event = cost;
+        } else {
+            costs[i / 2].per_thousand = cost;
+        }
+    }
+}
+
+// microamp hours per day at the rate seen since launch
+static uint32_t daily_charge(int event, uint32_t elapsed) {
+    uint64_t charge = (uint64_t)counts[event] * costs[event].event +
+            (uint64_t)amounts[event] * costs[event].per_thousand / 1000;
+    return charge * 24 / elapsed;
+}
+
+static void write_uint32(uint8_t *pos, uint32_t value) {
+    pos[0] = value & 0xFF;
+    pos[1] = value >> 8 & 0xFF;
+    pos[2] = value >> 16 & 0xFF;
+    pos[3] = value >> 24;
+}
+
+void send_energy_report() {
+    uint32_t elapsed = time(NULL) - counting_since;
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+
+    // the seconds counted, then per event its count, amount and daily
+    // charge, little endian uint32
+    uint8_t packed[4 + ENERGY_EVENTS * 12];
+    uint32_t total = 0;
+    write_uint32(packed, elapsed);
+    for (int event = 0; event < ENERGY_EVENTS; ++event) {
+        uint32_t charge = daily_charge(event, elapsed);
+        total += charge;
+        write_uint32(&packed[4 + event * 12], counts[event]);
+        write_uint32(&packed[8 + event * 12], amounts[event]);
+        write_uint32(&packed[12 + event * 12], charge);
+        APP_LOG(APP_LOG_LEVEL_INFO, "%s: %d, %d units, %d uAh/day", event_names[event],
+                (int)counts[event], (int)amounts[event], (int)charge);
+    }
+    APP_LOG(APP_LOG_LEVEL_INFO, "Energy: %d uAh/day over %d s", (int)total, (int)elapsed);
+
+    DictionaryIterator *iter;
+    if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Couldn't send energy report");
+        return;
+    }
+    dict_write_uint8(iter, KEY_DIAGNOSTICS, DIAGNOSTICS_ENERGY);
+    dict_write_data(iter, KEY_ENERGY, packed, sizeof(packed));
+    app_message_outbox_send();
+}
@@ -0,0 +1,24 @@
+#ifndef __TIMEBOXED_ENERGY_
+#define __TIMEBOXED_ENERGY_
+
+#include <pebble.h>
+
+// what is counted, each event with its number and an amount in the unit noted
+#define ENERGY_MESSAGE_OUT 0 // bytes
+#define ENERGY_MESSAGE_IN 1 // bytes
+#define ENERGY_HEALTH_QUERY 2 // none
+#define ENERGY_FLASH_WRITE 3 // bytes
+#define ENERGY_INVALIDATION 4 // pixels
+#define ENERGY_VIBRATION 5 // ms
+#define ENERGY_TICK 6 // ms of CPU time
+#define ENERGY_EVENTS 7
+
+void init_energy();
+void energy_count(int event, uint32_t amount);
+uint32_t energy_begin();
+void energy_end(int event, uint32_t start);
+
+void set_energy_costs(const uint8_t *data, uint16_t size);
+void send_energy_report();
+
+#endif
@@ -0,0 +1,90 @@
+#include <pebble.h>
+#include "fonts.h"
+
+// time, medium and base fonts for two font types (while swapping) plus weather and icons
+#define FONT_CACHE_SIZE 8
+
+struct CachedFont {
+    uint32_t resource_id;
+    GFont font;
+    uint8_t refs;
+};
+
+static struct CachedFont cache[FONT_CACHE_SIZE];
+static uint16_t load_count;
+static uint16_t reuse_count;
+static uint32_t load_time;
+
+static uint32_t get_elapsed_ms(time_t start_s, uint16_t start_ms) {
+    time_t now_s;
+    uint16_t now_ms;
+    time_ms(&now_s, &now_ms);
+    return (now_s - start_s) * 1000 + now_ms - start_ms;
+}
+
+GFont acquire_font(uint32_t resource_id) {
+    struct CachedFont *free_entry = NULL;
+    for (unsigned int i = 0; i < FONT_CACHE_SIZE; ++i) {
+        if (cache[i].refs > 0 && cache[i].resource_id == resource_id) {
+            cache[i].refs++;
+            reuse_count++;
+            return cache[i].font;
+        }
+        if (cache[i].refs == 0 && !free_entry) {
+            free_entry = &cache[i];
+        }
+    }
+
+    if (!free_entry) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Font cache full, can't load %d", (int)resource_id);
+        return NULL;
+    }
+
+    time_t start_s;
+    uint16_t start_ms;
+    time_ms(&start_s, &start_ms);
+
+    free_entry->font = fonts_load_custom_font(resource_get_handle(resource_id));
+    free_entry->resource_id = resource_id;
+    free_entry->refs = 1;
+
+    load_count++;
+    load_time += get_elapsed_ms(start_s, start_ms);
+    return free_entry->font;
+}
+
+void release_font(uint32_t resource_id) {
+    for (unsigned int i = 0; i < FONT_CACHE_SIZE; ++i) {
+        if (cache[i].refs > 0 && cache[i].resource_id == resource_id) {
+            cache[i].refs--;
+            if (cache[i].refs == 0) {
+                fonts_unload_custom_font(cache[i].font);
+                cache[i].font = NULL;
+            }
+            return;
+        }
+    }
+}
+
+uint16_t get_font_load_count() {
+    return load_count;
+}
+
+uint16_t get_font_reuse_count() {
+    return reuse_count;
+}
+
+uint32_t get_font_load_time() {
+    return load_time;
+}
+
+void log_font_cache_stats() {
+    int cached = 0;
+    for (unsigned int i = 0; i < FONT_CACHE_SIZE; ++i) {
+        if (cache[i].refs > 0) {
+            cached++;
+        }
+    }
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Font cache: %d loaded, %d loads, %d reuses, %dms loading",
+            cached, load_count, reuse_count, (int)load_time);
+}
@@ -0,0 +1,14 @@
+#ifndef __TIMEBOXED_FONTS_
+#define __TIMEBOXED_FONTS_
+
+#include <pebble.h>
+
+GFont acquire_font(uint32_t resource_id);
+void release_font(uint32_t resource_id);
+
+uint16_t get_font_load_count();
+uint16_t get_font_reuse_count();
+uint32_t get_font_load_time();
+void log_font_cache_stats();
+
+#endif
@@ -3,12 +3,18 @@
 #include "health.h"
 #include "text.h"
 #include "configs.h"
+#include "modules.h"
 #include "screen.h"
-
+#include "memory.h"
+#include "profiler.h"
+#include "storage.h"
+#include "power.h"
+#include "scheduler.h"
+#include "healthlog.h"
+#include "energy.h"
 
 #if defined(PBL_HEALTH)
 static bool health_enabled;
-static int woke_up_at;
 static bool was_asleep;
 static bool sleep_data_visible;
 static bool sleep_data_enabled;
@@ -16,12 +22,23 @@ static bool useKm;
 static bool useCalories;
 static bool update_queued;
 static bool is_sleeping;
-static bool sleep_status_updated;
-static char steps_text[8];
-static char cal_text[10];
-static char dist_text[10];
-static char sleep_text[8];
-static char deep_text[8];
+static bool sleep_status_known;
+
+// the reads of the health database, counted for the energy model
+static HealthValue query_sum_today(HealthMetric metric) {
+    energy_count(ENERGY_HEALTH_QUERY, 0);
+    return health_service_sum_today(metric);
+}
+
+static HealthValue query_sum(HealthMetric metric, time_t start, time_t end) {
+    energy_count(ENERGY_HEALTH_QUERY, 0);
+    return health_service_sum(metric, start, end);
+}
+
+static HealthValue query_sum_averaged(HealthMetric metric, time_t start, time_t end, HealthServiceTimeScope scope) {
+    energy_count(ENERGY_HEALTH_QUERY, 0);
+    return health_service_sum_averaged(metric, start, end, scope);
+}
 
 static void clear_health_fields() {
     set_steps_layer_text("");
@@ -45,6 +62,7 @@ static bool health_permission_granted() {
 }
 
 static void get_steps_data() {
+    char steps_text[HEALTH_TEXT_LEN];
     time_t start = time_start_of_today();
     time_t end = time(NULL);
     int one_day = 24 * SECONDS_PER_HOUR;
@@ -56,17 +74,17 @@ static void get_steps_data() {
         health_service_metric_accessible(metric_steps, start, end);
 
     if (mask_steps & HealthServiceAccessibilityMaskAvailable) {
-        current_steps = (int)health_service_sum_today(metric_steps);
+        current_steps = (int)query_sum_today(metric_steps);
 
         steps_last_week = 0;
         HealthServiceAccessibilityMask mask_steps_average =
             health_service_metric_averaged_accessible(metric_steps, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
 
         if (mask_steps_average & HealthServiceAccessibilityMaskAvailable) {
-            steps_last_week = (int)health_service_sum_averaged(metric_steps, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
+            steps_last_week = (int)query_sum_averaged(metric_steps, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
         } else {
             for (int i = 7; i <= 28; i = i+7) {
-                steps_last_week += (int)health_service_sum(metric_steps, start - i*one_day, end - i*one_day);
+                steps_last_week += (int)query_sum(metric_steps, start - i*one_day, end - i*one_day);
             }
             steps_last_week /= 4;
         }
@@ -81,6 +99,7 @@ static void get_steps_data() {
 }
 
 static void get_dist_data() {
+    char dist_text[HEALTH_TEXT_LEN];
     time_t start = time_start_of_today();
     time_t end = time(NULL);
     int one_day = 24 * SECONDS_PER_HOUR;
@@ -95,17 +114,17 @@ static void get_dist_data() {
         health_service_metric_accessible(metric_dist, start, end);
 
     if (mask_dist & HealthServiceAccessibilityMaskAvailable) {
-        current_dist = (int)health_service_sum_today(metric_dist);
+        current_dist = (int)query_sum_today(metric_dist);
 
         dist_last_week = 0;
         HealthServiceAccessibilityMask mask_dist_average =
             health_service_metric_averaged_accessible(metric_dist, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
 
         if (mask_dist_average & HealthServiceAccessibilityMaskAvailable) {
-            dist_last_week = (int)health_service_sum_averaged(metric_dist, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
+            dist_last_week = (int)query_sum_averaged(metric_dist, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
         } else {
             for (int i = 7; i <= 28; i = i+7) {
-                dist_last_week += (int)health_service_sum(metric_dist, start - i*one_day, end - i*one_day);
+                dist_last_week += (int)query_sum(metric_dist, start - i*one_day, end - i*one_day);
             }
             dist_last_week /= 4;
         }
@@ -126,6 +145,8 @@ static void get_dist_data() {
 
 static void get_cal_data() {
 
+    char cal_text[HEALTH_TEXT_LEN];
+
     HealthMetric metric_cal_rest = HealthMetricRestingKCalories;
     HealthMetric metric_cal_act = HealthMetricActiveKCalories;
 
@@ -144,7 +165,7 @@ static void get_cal_data() {
 
     bool has_cal_metric = (mask_cal_rest & HealthServiceAccessibilityMaskAvailable) || (mask_cal_act & HealthServiceAccessibilityMaskAvailable);
     if (has_cal_metric) {
-        current_cal = (int)health_service_sum_today(metric_cal_rest) + (int)health_service_sum_today(metric_cal_act);
+        current_cal = (int)query_sum_today(metric_cal_rest) + (int)query_sum_today(metric_cal_act);
 
         cal_last_week = 0;
         HealthServiceAccessibilityMask mask_cal_rest_average =
@@ -153,12 +174,12 @@ static void get_cal_data() {
             health_service_metric_averaged_accessible(metric_cal_act, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
 
         if ((mask_cal_rest_average & HealthServiceAccessibilityMaskAvailable) || mask_cal_act_average & HealthServiceAccessibilityMaskAvailable) {
-            cal_last_week += (int)health_service_sum_averaged(metric_cal_rest, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
-            cal_last_week += (int)health_service_sum_averaged(metric_cal_act, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
+            cal_last_week += (int)query_sum_averaged(metric_cal_rest, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
+            cal_last_week += (int)query_sum_averaged(metric_cal_act, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
         } else {
             for (int i = 7; i <= 28; i = i+7) {
-                cal_last_week += (int)health_service_sum(metric_cal_rest, start - i*one_day, end - i*one_day);
-                cal_last_week += (int)health_service_sum(metric_cal_act, start - i*one_day, end - i*one_day);
+                cal_last_week += (int)query_sum(metric_cal_rest, start - i*one_day, end - i*one_day);
+                cal_last_week += (int)query_sum(metric_cal_act, start - i*one_day, end - i*one_day);
             }
             cal_last_week /= 4;
         }
@@ -174,6 +195,8 @@ static void get_cal_data() {
 
 static void get_sleep_data() {
 
+    char sleep_text[HEALTH_TEXT_LEN];
+
     time_t start = time_start_of_today();
     time_t end = time(NULL);
     int one_day = 24 * SECONDS_PER_HOUR;
@@ -188,14 +211,14 @@ static void get_sleep_data() {
         health_service_metric_averaged_accessible(metric_sleep, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
 
     if (mask_sleep & HealthServiceAccessibilityMaskAvailable) {
-        current_sleep = (int)health_service_sum_today(metric_sleep);
+        current_sleep = (int)query_sum_today(metric_sleep);
 
         sleep_last_week = 0;
         if (mask_sleep_average & HealthServiceAccessibilityMaskAvailable) {
-            sleep_last_week = (int)health_service_sum_averaged(metric_sleep, start, start + 24*SECONDS_PER_HOUR-1, HealthServiceTimeScopeDailyWeekdayOrWeekend);
+            sleep_last_week = (int)query_sum_averaged(metric_sleep, start, start + 24*SECONDS_PER_HOUR-1, HealthServiceTimeScopeDailyWeekdayOrWeekend);
         } else {
             for (int i = 1; i <= 7; i++) {
-                sleep_last_week += (int)health_service_sum(metric_sleep, start - i*one_day, start - (i-1)*one_day);
+                sleep_last_week += (int)query_sum(metric_sleep, start - i*one_day, start - (i-1)*one_day);
             }
             sleep_last_week /= 7;
         }
@@ -213,6 +236,8 @@ static void get_sleep_data() {
 
 static void get_deep_data() {
 
+    char deep_text[HEALTH_TEXT_LEN];
+
     time_t start = time_start_of_today();
     time_t end = time(NULL);
     int one_day = 24 * SECONDS_PER_HOUR;
@@ -227,14 +252,14 @@ static void get_deep_data() {
         health_service_metric_averaged_accessible(metric_deep, start, end, HealthServiceTimeScopeDailyWeekdayOrWeekend);
 
     if (mask_deep & HealthServiceAccessibilityMaskAvailable) {
-        current_deep = (int)health_service_sum_today(metric_deep);
+        current_deep = (int)query_sum_today(metric_deep);
 
         deep_last_week = 0;
         if (mask_deep_average & HealthServiceAccessibilityMaskAvailable) {
-            deep_last_week = (int)health_service_sum_averaged(metric_deep, start, start + 24*SECONDS_PER_HOUR-1, HealthServiceTimeScopeDailyWeekdayOrWeekend);
+            deep_last_week = (int)query_sum_averaged(metric_deep, start, start + 24*SECONDS_PER_HOUR-1, HealthServiceTimeScopeDailyWeekdayOrWeekend);
         } else {
             for (int i = 1; i <= 7; i++) {
-                deep_last_week += (int)health_service_sum(metric_deep, start - i*one_day, start - (i-1)*one_day);
+                deep_last_week += (int)query_sum(metric_deep, start - i*one_day, start - (i-1)*one_day);
             }
             deep_last_week /= 7;
         }
@@ -251,31 +276,44 @@ static void get_deep_data() {
 
 }
 
+// the update hook of the health modules
+void update_health_module(int module) {
+    switch (module) {
+        case MODULE_STEPS:
+            get_steps_data();
+            break;
+        case MODULE_DIST:
+            get_dist_data();
+            break;
+        case MODULE_CAL:
+            get_cal_data();
+            break;
+        case MODULE_SLEEP:
+            get_sleep_data();
+            break;
+        case MODULE_DEEP:
+            get_deep_data();
+            break;
+    }
+}
+
+uint8_t health_refresh_interval() {
+    return get_power_profile()->health_interval;
+}
+
 void queue_health_update() {
     APP_LOG(APP_LOG_LEVEL_DEBUG, "Queued health update. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
     update_queued = true;
 }
 
 void get_health_data() {
+    uint32_t start = profile_begin();
     if (health_enabled && update_queued) {
         update_queued = false;
         APP_LOG(APP_LOG_LEVEL_DEBUG, "Updating health data. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
-        if (is_module_enabled(MODULE_STEPS)) {
-            get_steps_data();
-        }
-        if (is_module_enabled(MODULE_DIST)) {
-            get_dist_data();
-        }
-        if (is_module_enabled(MODULE_CAL)) {
-            get_cal_data();
-        }
-        if (is_module_enabled(MODULE_SLEEP)) {
-            get_sleep_data();
-        }
-        if (is_module_enabled(MODULE_DEEP)) {
-            get_deep_data();
-        }
+        update_modules(FAMILY_HEALTH);
     }
+    profile_end(PROFILE_HEALTH, start);
 }
 
 void health_handler(HealthEventType event, void *context) {
@@ -286,49 +324,49 @@ void health_handler(HealthEventType event, void *context) {
             APP_LOG(APP_LOG_LEVEL_DEBUG, "Requesting update from event. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
             queue_health_update();
             break;
+        default:
+            // metric alerts and heart rate, not shown
+            break;
     }
 }
 
 static void load_health_data_from_storage() {
+    char text[HEALTH_TEXT_LEN];
     APP_LOG(APP_LOG_LEVEL_DEBUG, "Loading health data from storage. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
     if (is_module_enabled(MODULE_STEPS)) {
-        persist_read_string(KEY_STEPS, steps_text, sizeof(steps_text));
-        set_steps_layer_text(steps_text);
+        storage_read_string(KEY_STEPS, text, sizeof(text));
+        set_steps_layer_text(text);
         set_progress_color_steps(false);
     }
     if (is_module_enabled(MODULE_DIST)) {
-        persist_read_string(KEY_DIST, dist_text, sizeof(dist_text));
-        set_dist_layer_text(dist_text);
+        storage_read_string(KEY_DIST, text, sizeof(text));
+        set_dist_layer_text(text);
         set_progress_color_dist(false);
     }
     if (is_module_enabled(MODULE_CAL)) {
-        persist_read_string(KEY_CAL, cal_text, sizeof(cal_text));
-        set_cal_layer_text(cal_text);
+        storage_read_string(KEY_CAL, text, sizeof(text));
+        set_cal_layer_text(text);
         set_progress_color_cal(false);
     }
     if (is_module_enabled(MODULE_SLEEP)) {
-        persist_read_string(KEY_SLEEP, sleep_text, sizeof(sleep_text));
-        set_sleep_layer_text(sleep_text);
+        storage_read_string(KEY_SLEEP, text, sizeof(text));
+        set_sleep_layer_text(text);
         set_progress_color_sleep(false);
     }
     if (is_module_enabled(MODULE_DEEP)) {
-        persist_read_string(KEY_DEEP, deep_text, sizeof(deep_text));
-        set_deep_layer_text(deep_text);
+        storage_read_string(KEY_DEEP, text, sizeof(text));
+        set_deep_layer_text(text);
         set_progress_color_deep(false);
     }
 }
 
 static bool get_health_enabled() {
-    return is_health_toggle_enabled() ||
-        is_module_enabled(MODULE_STEPS) ||
-        is_module_enabled(MODULE_DIST) ||
-        is_module_enabled(MODULE_CAL) ||
-        is_module_enabled(MODULE_SLEEP) ||
-        is_module_enabled(MODULE_DEEP);
+    return is_health_toggle_enabled() || is_family_enabled(FAMILY_HEALTH);
 }
 
 void toggle_health(bool from_configs) {
-    is_sleeping = false;
+    memory_phase_begin(PHASE_TOGGLE_HEALTH);
+
     bool has_health = false;
     health_enabled = get_health_enabled();
     sleep_data_enabled = is_sleep_data_enabled();
@@ -347,8 +385,16 @@ void toggle_health(bool from_configs) {
             APP_LOG(APP_LOG_LEVEL_DEBUG, "Health permission granted. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
             has_health = health_service_events_subscribe(health_handler, NULL);
             if (has_health) {
+                if (!get_power_profile()->health_events) {
+                    // subscribing tells whether health works at all
+                    health_service_events_unsubscribe();
+                }
                 clear_health_fields();
                 queue_health_update();
+                if (!sleep_status_known) {
+                    // not waiting up to ten minutes for the scheduler
+                    refresh_sleep_status();
+                }
                 if (from_configs) {
                     get_health_data();
                 } else {
@@ -367,55 +413,82 @@ void toggle_health(bool from_configs) {
         APP_LOG(APP_LOG_LEVEL_DEBUG, "Health disabled. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
         clear_health_fields();
         health_service_events_unsubscribe();
+        is_sleeping = false;
+        sleep_status_known = false;
     }
+    configure_health_log(health_enabled && has_health);
+
+    memory_phase_end(PHASE_TOGGLE_HEALTH);
 }
 
-bool is_user_sleeping() {
+void set_health_events_enabled(bool enabled) {
     if (!health_enabled) {
-        return false;
+        return;
     }
-    time_t temp = time(NULL);
-    struct tm *tick_time = localtime(&temp);
-    if (tick_time->tm_min % 10 == 0) { // only check every 10 minutes
-        if (!sleep_status_updated) {
-            sleep_status_updated = true;
-            HealthActivityMask activities = health_service_peek_current_activities();
-            is_sleeping = activities & HealthActivitySleep || activities & HealthActivityRestfulSleep;
-        }
+    if (enabled) {
+        health_service_events_subscribe(health_handler, NULL);
     } else {
-        sleep_status_updated = false;
+        health_service_events_unsubscribe();
+    }
+}
+
+// every 10 minutes from the scheduler
+void refresh_sleep_status() {
+    if (health_enabled) {
+        HealthActivityMask activities = health_service_peek_current_activities();
+        energy_count(ENERGY_HEALTH_QUERY, 0);
+        is_sleeping = activities & HealthActivitySleep || activities & HealthActivityRestfulSleep;
+        sleep_status_known = true;
+        note_sleep_status(is_sleeping);
+    }
+}
+
+bool is_user_sleeping() {
+    return health_enabled && is_sleeping;
+}
+
+static void end_wake_window(void *context) {
+    if (get_power_profile()->suppress_redraws) {
+        // as if the tick had skipped it, looked at again the next minute
+        schedule_task_at(TASK_WAKE_WINDOW, end_wake_window, context, time(NULL) + SECONDS_PER_MINUTE, SECONDS_PER_MINUTE);
+        return;
+    }
+    if (health_enabled && sleep_data_enabled && sleep_data_visible) {
+        APP_LOG(APP_LOG_LEVEL_DEBUG, "Past half an hour after wake up! %d", (int) time(NULL));
+        sleep_data_visible = false;
+        switch_sleep_layout();
+        queue_health_update();
+        get_health_data();
     }
-    return is_sleeping;
 }
 
 void show_sleep_data_if_visible(Window *watchface) {
+    if (get_power_profile()->suppress_redraws) {
+        return;
+    }
     if (health_enabled && sleep_data_enabled) {
         if (is_user_sleeping()) {
             APP_LOG(APP_LOG_LEVEL_DEBUG, "We are asleep. %d", was_asleep);
             sleep_data_visible = true;
             if (!was_asleep) {
                 was_asleep = true;
-                woke_up_at = 0;
+                cancel_task(TASK_WAKE_WINDOW);
+                switch_sleep_layout();
                 queue_health_update();
-                redraw_screen(watchface);
+                get_health_data();
                 APP_LOG(APP_LOG_LEVEL_DEBUG, "Just went to sleep. %d", was_asleep);
             }
         }
 
         if (!is_user_sleeping() && was_asleep) {
             sleep_data_visible = true;
-            woke_up_at = time(NULL) + SECONDS_PER_MINUTE * 30; // 30 minutes
-            APP_LOG(APP_LOG_LEVEL_DEBUG, "We woke up! %d", (int) woke_up_at);
+            // joins the minute tick rather than waking up on its own
+            schedule_task_at(TASK_WAKE_WINDOW, end_wake_window, watchface, time(NULL) + SECONDS_PER_MINUTE * 30,
+                             SECONDS_PER_MINUTE);
+            APP_LOG(APP_LOG_LEVEL_DEBUG, "We woke up! %d", (int) time(NULL));
             was_asleep = false;
             queue_health_update();
         }
-
-        if (sleep_data_visible && woke_up_at > 0 && time(NULL) > woke_up_at) {
-            APP_LOG(APP_LOG_LEVEL_DEBUG, "Past half an hour after wake up! %d - %d", (int) time(NULL), (int) woke_up_at);
-            sleep_data_visible = false;
-            redraw_screen(watchface);
-            queue_health_update();
-        }
     }
 }
 
@@ -426,11 +499,12 @@ void init_sleep_data() {
 
 void save_health_data_to_storage() {
     APP_LOG(APP_LOG_LEVEL_DEBUG, "Storing health data. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
-    persist_write_string(KEY_STEPS, steps_text);
-    persist_write_string(KEY_DIST, dist_text);
-    persist_write_string(KEY_CAL, cal_text);
-    persist_write_string(KEY_SLEEP, sleep_text);
-    persist_write_string(KEY_DEEP, deep_text);
+    // the texts live in the layers' buffers only
+    storage_write_string(KEY_STEPS, get_module_text(MODULE_STEPS));
+    storage_write_string(KEY_DIST, get_module_text(MODULE_DIST));
+    storage_write_string(KEY_CAL, get_module_text(MODULE_CAL));
+    storage_write_string(KEY_SLEEP, get_module_text(MODULE_SLEEP));
+    storage_write_string(KEY_DEEP, get_module_text(MODULE_DEEP));
 }
 
 bool should_show_sleep_data() {
@@ -443,6 +517,14 @@ void toggle_health(bool from_configs) {
     APP_LOG(APP_LOG_LEVEL_DEBUG, "Health disabled. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
 }
 
+void set_health_events_enabled(bool enabled) {
+    return;
+}
+
+void refresh_sleep_status() {
+    return;
+}
+
 bool is_user_sleeping() {
     return false;
 }
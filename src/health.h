@@ -5,6 +5,9 @@
 
 void toggle_health(bool);
 
+void set_health_events_enabled(bool);
+
+void refresh_sleep_status();
 bool is_user_sleeping();
 
 void get_health_data();
@@ -19,4 +22,9 @@ void save_health_data_to_storage();
 
 bool should_show_sleep_data();
 
+#if defined(PBL_HEALTH)
+void update_health_module(int module);
+uint8_t health_refresh_interval();
+#endif
+
 #endif
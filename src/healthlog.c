@@ -0,0 +1,252 @@
+#include <pebble.h>
+#include "keys.h"
+#include "configs.h"
+#include "healthlog.h"
+#include "storage.h"
+#include "energy.h"
+
+#if defined(PBL_HEALTH)
+
+// Health history for the phone, in fixed size records: the steps, calories
+// and meters walked of each hour and each day, and the sleep of each night.
+// They collect here and go out together in one message every
+// get_health_log_interval() hours, sooner when the batch is about to fill,
+// so the radio is used a few times a day at most. The batch only reaches
+// flash on unload.
+#define RECORD_HOUR 1
+#define RECORD_DAY 2
+#define RECORD_SLEEP 3
+#define BATCH_RECORDS 18 // the batch state fits one persist entry
+#define BATCH_HEADROOM 3 // records the next run may add: an hour, a day, a night
+#define BATCH_RESERVED 2 // kept free of hours for a day and a night
+#define CATCHUP_HOURS 24 // hours missed while the face wasn't running
+#define SLEEP_MARGIN (10 * SECONDS_PER_MINUTE) // how late the sleep status can be noticed
+
+struct HealthBatch {
+    uint32_t hours_until; // start of the first hour not recorded yet
+    uint32_t days_until; // local midnight, end of the last day recorded
+    uint32_t asleep_since; // 0 while awake
+    uint32_t last_sent;
+    uint8_t count;
+    uint8_t records[BATCH_RECORDS * HEALTH_RECORD_SIZE];
+};
+
+static struct HealthBatch batch;
+static bool batch_loaded;
+static bool log_enabled;
+static uint8_t interval; // hours
+static uint8_t kinds;
+static uint8_t in_flight; // records in the message waiting for an answer
+static bool catching_up; // hours left behind for lack of room
+
+static uint16_t records_logged;
+static uint16_t records_sent;
+static uint16_t records_dropped;
+static uint16_t messages_sent;
+
+static uint16_t clamp_value(int32_t value) {
+    return value < 0 ? 0 : value > UINT16_MAX ? UINT16_MAX : value;
+}
+
+static void append_record(uint8_t type, time_t start, int32_t first, int32_t second, int32_t third) {
+    if (batch.count == BATCH_RECORDS) {
+        if (in_flight) {
+            records_dropped++;
+            return;
+        }
+        // the phone hasn't been around for a while, the oldest goes
+        memmove(batch.records, batch.records + HEALTH_RECORD_SIZE, (BATCH_RECORDS - 1) * HEALTH_RECORD_SIZE);
+        batch.count--;
+        records_dropped++;
+    }
+    uint8_t *record = &batch.records[batch.count++ * HEALTH_RECORD_SIZE];
+    uint16_t values[3] = { clamp_value(first), clamp_value(second), clamp_value(third) };
+    for (int i = 0; i < 4; ++i) {
+        record[i] = ((uint32_t)start >> (8 * i)) & 0xFF;
+    }
+    record[4] = type;
+    record[5] = 0;
+    for (int i = 0; i < 3; ++i) {
+        record[6 + 2 * i] = values[i] & 0xFF;
+        record[7 + 2 * i] = values[i] >> 8;
+    }
+    records_logged++;
+}
+
+static int32_t sum_metric(HealthMetric metric, time_t start, time_t end) {
+    energy_count(ENERGY_HEALTH_QUERY, 0);
+    return (int32_t)health_service_sum(metric, start, end);
+}
+
+static void log_activity(uint8_t type, time_t start, time_t end) {
+    append_record(type, start,
+                  sum_metric(HealthMetricStepCount, start, end),
+                  sum_metric(HealthMetricActiveKCalories, start, end) + sum_metric(HealthMetricRestingKCalories, start, end),
+                  sum_metric(HealthMetricWalkedDistanceMeters, start, end));
+}
+
+static time_t start_of_day(time_t when) {
+    struct tm *local = localtime(&when);
+    local->tm_hour = 0;
+    local->tm_min = 0;
+    local->tm_sec = 0;
+    return mktime(local);
+}
+
+static void log_hours(time_t now) {
+    time_t hour = now - now % SECONDS_PER_HOUR;
+    if (!batch.hours_until) {
+        batch.hours_until = hour; // nothing before the first run
+    } else if (batch.hours_until + CATCHUP_HOURS * SECONDS_PER_HOUR < (uint32_t)hour) {
+        batch.hours_until = hour - CATCHUP_HOURS * SECONDS_PER_HOUR;
+    }
+    // a long catch-up stops when the batch is full, the rest follows once it
+    // went out, from where it stopped
+    catching_up = false;
+    for (; batch.hours_until < (uint32_t)hour; batch.hours_until += SECONDS_PER_HOUR) {
+        if (kinds & HEALTHLOG_HOURLY) {
+            if (batch.count + BATCH_RESERVED >= BATCH_RECORDS) {
+                catching_up = true;
+                break;
+            }
+            log_activity(RECORD_HOUR, batch.hours_until, batch.hours_until + SECONDS_PER_HOUR);
+        }
+    }
+}
+
+// only yesterday is caught up, health keeps the rest anyway
+static void log_days() {
+    time_t today = time_start_of_today();
+    if (batch.days_until && (uint32_t)today > batch.days_until && kinds & HEALTHLOG_DAILY) {
+        log_activity(RECORD_DAY, start_of_day(today - SECONDS_PER_HOUR), today);
+    }
+    batch.days_until = today;
+}
+
+static void send_batch() {
+    if (in_flight || batch.count == 0 || !connection_service_peek_pebble_app_connection()) {
+        return;
+    }
+    DictionaryIterator *iter;
+    if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+        return; // tried again the next hour
+    }
+    dict_write_data(iter, KEY_HEALTHBATCH, batch.records, batch.count * HEALTH_RECORD_SIZE);
+    app_message_outbox_send();
+    in_flight = batch.count;
+}
+
+// hourly from the scheduler
+void health_log_task(void *context) {
+    if (!log_enabled) {
+        return;
+    }
+    time_t now = time(NULL);
+    log_hours(now);
+    log_days();
+    if (batch.count + BATCH_HEADROOM > BATCH_RECORDS ||
+            (uint32_t)now >= batch.last_sent + interval * SECONDS_PER_HOUR) {
+        send_batch();
+    }
+}
+
+// from every sleep status refresh, a night is recorded when it ends
+void note_sleep_status(bool sleeping) {
+    if (!log_enabled || !(kinds & HEALTHLOG_SLEEP)) {
+        return;
+    }
+    time_t now = time(NULL);
+    if (sleeping && !batch.asleep_since) {
+        batch.asleep_since = now;
+    } else if (!sleeping && batch.asleep_since) {
+        time_t start = batch.asleep_since - SLEEP_MARGIN;
+        batch.asleep_since = 0;
+        append_record(RECORD_SLEEP, start,
+                      sum_metric(HealthMetricSleepSeconds, start, now) / SECONDS_PER_MINUTE,
+                      sum_metric(HealthMetricSleepRestfulSeconds, start, now) / SECONDS_PER_MINUTE,
+                      (now - start) / SECONDS_PER_MINUTE);
+    }
+}
+
+void health_log_sent(DictionaryIterator *iterator) {
+    if (!in_flight || !dict_find(iterator, KEY_HEALTHBATCH)) {
+        return;
+    }
+    batch.count -= in_flight;
+    memmove(batch.records, batch.records + in_flight * HEALTH_RECORD_SIZE, batch.count * HEALTH_RECORD_SIZE);
+    batch.last_sent = time(NULL);
+    records_sent += in_flight;
+    messages_sent++;
+    in_flight = 0;
+    if (catching_up) {
+        health_log_task(NULL);
+    }
+}
+
+// kept for the next hour
+void health_log_failed(DictionaryIterator *iterator) {
+    if (in_flight && dict_find(iterator, KEY_HEALTHBATCH)) {
+        in_flight = 0;
+    }
+}
+
+void configure_health_log(bool health_available) {
+    interval = get_health_log_interval();
+    kinds = get_health_log_records();
+    log_enabled = health_available && interval > 0 && kinds;
+    if (!batch_loaded) {
+        batch_loaded = true;
+        if (storage_read_data(KEY_HEALTHBATCH, &batch, sizeof(batch)) != (int)sizeof(batch)) {
+            memset(&batch, 0, sizeof(batch));
+        }
+    }
+    if (!log_enabled) {
+        memset(&batch, 0, sizeof(batch));
+        in_flight = 0;
+    }
+}
+
+void save_health_log() {
+    if (log_enabled) {
+        storage_write_data(KEY_HEALTHBATCH, &batch, sizeof(batch));
+    } else if (batch_loaded) {
+        storage_delete(KEY_HEALTHBATCH);
+    }
+}
+
+void log_health_log_report() {
+    APP_LOG(APP_LOG_LEVEL_INFO, "Health log: every %dh, records %d, %d logged, %d sent in %d messages, %d dropped, %d pending",
+            interval, kinds, records_logged, records_sent, messages_sent, records_dropped, batch.count);
+}
+
+#else // Health not available
+
+void configure_health_log(bool health_available) {
+    return;
+}
+
+void health_log_task(void *context) {
+    return;
+}
+
+void note_sleep_status(bool sleeping) {
+    return;
+}
+
+void health_log_sent(DictionaryIterator *iterator) {
+    return;
+}
+
+void health_log_failed(DictionaryIterator *iterator) {
+    return;
+}
+
+void save_health_log() {
+    return;
+}
+
+void log_health_log_report() {
+    APP_LOG(APP_LOG_LEVEL_INFO, "Health log: not available");
+}
+
+#endif
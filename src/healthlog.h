@@ -0,0 +1,18 @@
+#ifndef __TIMEBOXED_HEALTHLOG_
+#define __TIMEBOXED_HEALTHLOG_
+
+#include <pebble.h>
+
+#define HEALTHLOG_HOURLY 0x01
+#define HEALTHLOG_DAILY 0x02
+#define HEALTHLOG_SLEEP 0x04
+
+void configure_health_log(bool health_available);
+void health_log_task(void *context);
+void note_sleep_status(bool sleeping);
+void health_log_sent(DictionaryIterator *iterator);
+void health_log_failed(DictionaryIterator *iterator);
+void save_health_log();
+void log_health_log_report();
+
+#endif
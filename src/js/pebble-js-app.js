@@ -9,18 +9,100 @@ var WUNDERGROUND = 1;
 var YAHOO = 2;
 var FORECAST = 3;
 
+var DIAGNOSTICS_MEMORY = 1;
+var DIAGNOSTICS_PROFILE = 2;
+var DIAGNOSTICS_STORAGE = 3;
+var DIAGNOSTICS_POWER = 4;
+var DIAGNOSTICS_SCHEDULER = 5;
+var DIAGNOSTICS_HEALTHLOG = 6;
+var DIAGNOSTICS_ENERGY = 7;
+
+// health records from the watch, HEALTH_RECORD_SIZE bytes each, kept in
+// localStorage.healthHistory as [start, type, three values], oldest first.
+// Hours and days carry steps, kcal and meters, nights sleep, restful and
+// total minutes
+var HEALTH_RECORD_SIZE = 12;
+var HEALTH_RECORD_TYPES = {1: 'hour', 2: 'day', 3: 'sleep'};
+var HEALTH_HISTORY_LIMIT = 4000;
+
+// every request gives up after REQUEST_TIMEOUT ms or past REQUEST_MAX_LENGTH
+// characters. GETs are conditional: the validators of the last
+// CACHE_ENTRIES responses, with their text when it fits CACHE_MAX_LENGTH,
+// are kept in localStorage.httpCache so an unchanged resource costs a 304
+var REQUEST_TIMEOUT = 15000;
+var REQUEST_MAX_LENGTH = 64 * 1024;
+var CACHE_MAX_LENGTH = 4 * 1024;
+var CACHE_ENTRIES = 8;
+
+// messages to the watch go out one at a time, see sendMessage. A NACK is
+// retried SEND_RETRIES times, SEND_RETRY_MS apart and doubling each time
+var SEND_RETRIES = 3;
+var SEND_RETRY_MS = 500;
+
+// number of entries in the timezone transition table, see TZ_TRANSITIONS
+var TZ_TRANSITIONS = 6;
+
+// config and table keys of each world clock, the alt time first
+var WORLD_CLOCK_KEYS = ['KEY_TIMEZONES', 'KEY_TIMEZONES2', 'KEY_TIMEZONES3'];
+var TZ_TRANSITION_KEYS = ['KEY_TZTRANSITIONS', 'KEY_TZTRANSITIONS2', 'KEY_TZTRANSITIONS3'];
+
+// DST rules per family: month (0 based), Sunday of the month (-1 is the
+// last one) and minutes after midnight, local time before the change unless
+// utc is set
+var DST_RULES = {
+    US: {start: [2, 2, 120], end: [10, 1, 120]},
+    EU: {start: [2, -1, 60], end: [9, -1, 60], utc: true},
+    AU: {start: [9, 1, 120], end: [3, 1, 180]},
+    NZ: {start: [8, -1, 120], end: [3, 1, 180]}
+};
+
+// zone codes the config page offers that observe DST, and whether the code
+// names the daylight time
+var TIMEZONE_RULES = {
+    AKST: ['US', false], AKDT: ['US', true], PST: ['US', false], PDT: ['US', true],
+    MST: ['US', false], MDT: ['US', true], CST: ['US', false], CDT: ['US', true],
+    EST: ['US', false], EDT: ['US', true], AST: ['US', false], ADT: ['US', true],
+    WET: ['EU', false], WEST: ['EU', true], BST: ['EU', true],
+    CET: ['EU', false], CEST: ['EU', true], EET: ['EU', false], EEST: ['EU', true],
+    ACST: ['AU', false], ACDT: ['AU', true], AEST: ['AU', false], AEDT: ['AU', true],
+    NZST: ['NZ', false], NZDT: ['NZ', true]
+};
+
+var PROFILE_PATHS = ['tick_handler', 'update_time', 'get_health_data', 'inbox_received', 'load_screen', 'render'];
+var PROFILE_BUCKET_LIMITS = [2, 5, 10, 20, 50, 100, 250];
+
+// the ENERGY_* events of src/energy.c and the subsystem each one is charged to
+var ENERGY_EVENTS = ['messages out', 'messages in', 'health queries', 'flash writes', 'invalidations',
+                     'vibrations', 'tick cpu'];
+var ENERGY_SUBSYSTEMS = ['radio', 'radio', 'health', 'flash', 'display', 'vibration', 'cpu'];
+var ENERGY_REPORTS_KEPT = 8;
+
 Pebble.addEventListener("ready",
     function(e) {
         console.log("Pebble Ready!");
+        // set localStorage.diagnostics to a DIAGNOSTICS_* value to have the
+        // watch log that report (memory and profile need --instrument), for
+        // the energy report localStorage.energyCosts replaces the watch's
+        // cost model
+        if (localStorage.diagnostics) {
+            requestDiagnostics(parseInt(localStorage.diagnostics, 10));
+        }
     }
 );
 
 Pebble.addEventListener('appmessage',
     function(e) {
         console.log('AppMessage received!');
-        if (e.payload.KEY_HASUPDATE) {
+        if (e.payload.KEY_DIAGNOSTICS) {
+            logDiagnostics(e.payload);
+        } else if (e.payload.KEY_TZTRANSITIONS) {
+            console.log('Sending timezone transitions...');
+            sendTimezoneTransitions([e.payload.KEY_TZTRANSITIONS - 1]);
+        } else if (e.payload.KEY_HASUPDATE) {
             console.log('Checking for updates...');
             checkForUpdates();
+        } else if (e.payload.KEY_HEALTHBATCH) {
+            storeHealthRecords(e.payload.KEY_HEALTHBATCH);
         } else {
             console.log('Fetching weather info...');
             var weatherKey = localStorage.weatherKey;
@@ -44,11 +126,209 @@ Pebble.addEventListener('appmessage',
     }
 );
 
+// The settings page ships in this file and opens as a data: URI, so it shows
+// at once and works offline. Each field is [name, label, type, options], the
+// name being the message key without KEY_; the page returns the values the
+// same way the hosted one did, through webviewclosed.
+var TIMEZONE_OPTIONS = [
+    ['#|0:0', 'None'], ['UTC|0:0', 'UTC'], ['HST|-10:0', 'Hawaii (HST)'],
+    ['AKST|-9:0', 'Alaska (AKST)'], ['AKDT|-8:0', 'Alaska (AKDT)'],
+    ['PST|-8:0', 'Pacific (PST)'], ['PDT|-7:0', 'Pacific (PDT)'],
+    ['MST|-7:0', 'Mountain (MST)'], ['MDT|-6:0', 'Mountain (MDT)'],
+    ['CST|-6:0', 'Central (CST)'], ['CDT|-5:0', 'Central (CDT)'],
+    ['EST|-5:0', 'Eastern (EST)'], ['EDT|-4:0', 'Eastern (EDT)'],
+    ['AST|-4:0', 'Atlantic (AST)'], ['ADT|-3:0', 'Atlantic (ADT)'],
+    ['BRT|-3:0', 'Brasilia (BRT)'], ['WET|0:0', 'Western Europe (WET)'],
+    ['WEST|1:0', 'Western Europe (WEST)'], ['BST|1:0', 'British Summer (BST)'],
+    ['CET|1:0', 'Central Europe (CET)'], ['CEST|2:0', 'Central Europe (CEST)'],
+    ['EET|2:0', 'Eastern Europe (EET)'], ['EEST|3:0', 'Eastern Europe (EEST)'],
+    ['MSK|3:0', 'Moscow (MSK)'], ['GST|4:0', 'Gulf (GST)'], ['IST|5:30', 'India (IST)'],
+    ['ICT|7:0', 'Indochina (ICT)'], ['CST|8:0', 'China (CST)'], ['JST|9:0', 'Japan (JST)'],
+    ['ACST|9:30', 'Central Australia (ACST)'], ['ACDT|10:30', 'Central Australia (ACDT)'],
+    ['AEST|10:0', 'Eastern Australia (AEST)'], ['AEDT|11:0', 'Eastern Australia (AEDT)'],
+    ['NZST|12:0', 'New Zealand (NZST)'], ['NZDT|13:0', 'New Zealand (NZDT)']
+];
+
+// 9 and 10, feels like, have no module on the watch and are not offered
+var MODULE_OPTIONS = [
+    [0, 'None'], [1, 'Weather'], [2, 'Forecast'], [8, 'Wind'], [3, 'Steps'], [4, 'Distance'], [5, 'Calories'], [6, 'Sleep'], [7, 'Deep sleep'],
+    [11, 'Second world clock'], [12, 'Third world clock']
+];
+
+var CONFIG_SECTIONS = [
+    ['General', [
+        ['fontType', 'Font', 'select', [[0, 'Blocko'], [1, 'Blocko (big)'], [2, 'System'],
+            [3, 'Archivo'], [4, 'DIN'], [5, 'Prototype']]],
+        ['textAlign', 'Text alignment', 'select', [[0, 'Left'], [1, 'Center'], [2, 'Right']]],
+        ['locale', 'Language', 'select', [[0, 'English'], [1, 'Portuguese'], [2, 'French'],
+            [3, 'German'], [4, 'Spanish'], [5, 'Italian'], [6, 'Dutch'], [7, 'Danish'],
+            [8, 'Turkish'], [9, 'Czech'], [10, 'Polish'], [11, 'Swedish'], [12, 'Finnish'], [13, 'Slovak']]],
+        ['dateFormat', 'Date format', 'select', [[0, 'Weekday, month day'], [1, 'Weekday, day month']]],
+        ['leadingZero', 'Leading zero on the hour', 'checkbox'],
+        ['simpleMode', 'Simple mode', 'checkbox'],
+        ['bluetoothDisconnect', 'Vibrate when Bluetooth disconnects', 'checkbox'],
+        ['update', 'Show when an update is available', 'checkbox']
+    ]],
+    ['World clocks', [
+        ['timezones', 'Alternate time', 'select', TIMEZONE_OPTIONS],
+        ['timezones2', 'Second world clock', 'select', TIMEZONE_OPTIONS],
+        ['timezones3', 'Third world clock', 'select', TIMEZONE_OPTIONS]
+    ]],
+    ['Modules', [
+        ['slotA', 'Slot A', 'select', MODULE_OPTIONS],
+        ['slotB', 'Slot B', 'select', MODULE_OPTIONS],
+        ['slotC', 'Slot C', 'select', MODULE_OPTIONS],
+        ['slotD', 'Slot D', 'select', MODULE_OPTIONS],
+        ['sleepSlotA', 'Slot A while asleep', 'select', MODULE_OPTIONS],
+        ['sleepSlotB', 'Slot B while asleep', 'select', MODULE_OPTIONS],
+        ['sleepSlotC', 'Slot C while asleep', 'select', MODULE_OPTIONS],
+        ['sleepSlotD', 'Slot D while asleep', 'select', MODULE_OPTIONS]
+    ]],
+    ['Weather', [
+        ['enableWeather', 'Enable weather', 'checkbox'],
+        ['useCelsius', 'Use Celsius', 'checkbox'],
+        ['weatherProvider', 'Provider', 'select', [[OPEN_WEATHER, 'OpenWeatherMap'],
+            [WUNDERGROUND, 'Weather Underground'], [YAHOO, 'Yahoo'], [FORECAST, 'Forecast.io']]],
+        ['weatherKey', 'Weather Underground key', 'text'],
+        ['forecastKey', 'Forecast.io key', 'text'],
+        ['overrideLocation', 'Location (empty to use GPS)', 'text'],
+        ['speedUnit', 'Wind speed', 'select', [[0, 'mph'], [1, 'km/h'], [2, 'knots']]]
+    ]],
+    ['Health', [
+        ['enableHealth', 'Enable health', 'checkbox'],
+        ['useKm', 'Distance in km', 'checkbox'],
+        ['useCal', 'Show active calories', 'checkbox'],
+        ['showSleep', 'Show sleep data while asleep', 'checkbox'],
+        ['healthLog', 'Send history to the phone', 'select', [[0, 'Never'], [1, 'Every hour'],
+            [6, 'Every 6 hours'], [24, 'Once a day']]],
+        ['healthLogRecords', 'History kept', 'select', [[7, 'Hours, days and nights'],
+            [6, 'Days and nights'], [2, 'Days only']]]
+    ]],
+    ['Colors', [
+        ['enableAdvanced', 'Custom colors', 'checkbox'],
+        ['bgColor', 'Background', 'color'], ['hoursColor', 'Time', 'color'],
+        ['dateColor', 'Date', 'color'], ['altHoursColor', 'World clocks', 'color'],
+        ['batteryColor', 'Battery', 'color'], ['batteryLowColor', 'Battery low', 'color'],
+        ['bluetoothColor', 'Bluetooth', 'color'], ['updateColor', 'Update', 'color'],
+        ['weatherColor', 'Weather', 'color'], ['tempColor', 'Temperature', 'color'],
+        ['minColor', 'Minimum', 'color'], ['maxColor', 'Maximum', 'color'],
+        ['windDirColor', 'Wind direction', 'color'], ['windSpeedColor', 'Wind speed', 'color'],
+        ['stepsColor', 'Steps', 'color'], ['stepsBehindColor', 'Steps behind', 'color'],
+        ['distColor', 'Distance', 'color'], ['distBehindColor', 'Distance behind', 'color'],
+        ['calColor', 'Calories', 'color'], ['calBehindColor', 'Calories behind', 'color'],
+        ['sleepColor', 'Sleep', 'color'], ['sleepBehindColor', 'Sleep behind', 'color'],
+        ['deepColor', 'Deep sleep', 'color'], ['deepBehindColor', 'Deep sleep behind', 'color']
+    ]]
+];
+
+// what the page offers before anything was saved
+var CONFIG_DEFAULTS = {
+    fontType: 0, textAlign: 2, locale: 0, dateFormat: 0, leadingZero: false, simpleMode: false,
+    bluetoothDisconnect: true, update: true,
+    timezones: '#|0:0', timezones2: '#|0:0', timezones3: '#|0:0',
+    slotA: 1, slotB: 2, slotC: 3, slotD: 4, sleepSlotA: 6, sleepSlotB: 7, sleepSlotC: 1, sleepSlotD: 2,
+    enableWeather: true, useCelsius: false, weatherProvider: OPEN_WEATHER, weatherKey: '',
+    forecastKey: '', overrideLocation: '', speedUnit: 0,
+    enableHealth: true, useKm: false, useCal: false, showSleep: true, healthLog: 6, healthLogRecords: 7,
+    enableAdvanced: false, bgColor: '0x000000', hoursColor: '0xFFFFFF', dateColor: '0xFFFFFF',
+    altHoursColor: '0xFFFFFF', batteryColor: '0xFFFFFF', batteryLowColor: '0xFF0000',
+    bluetoothColor: '0xFF0000', updateColor: '0x00FF00', weatherColor: '0xFFFFFF',
+    tempColor: '0xFFFFFF', minColor: '0x00FFFF', maxColor: '0xFF5500', windDirColor: '0xFFFFFF',
+    windSpeedColor: '0xFFFFFF', stepsColor: '0xFFFFFF', stepsBehindColor: '0xFFFF00',
+    distColor: '0xFFFFFF', distBehindColor: '0xFFFF00', calColor: '0xFFFFFF',
+    calBehindColor: '0xFFFF00', sleepColor: '0xFFFFFF', sleepBehindColor: '0xFFFF00',
+    deepColor: '0xFFFFFF', deepBehindColor: '0xFFFF00'
+};
+
+// reads the values back and closes with them, as the hosted page did
+var CONFIG_PAGE_SCRIPT =
+    'function save() {' +
+    '  var data = {};' +
+    '  var inputs = document.querySelectorAll("[name]");' +
+    '  for (var i = 0; i < inputs.length; i++) {' +
+    '    var input = inputs[i];' +
+    '    if (input.type === "checkbox") { data[input.name] = input.checked; }' +
+    '    else if (input.type === "color") { data[input.name] = "0x" + input.value.substr(1).toUpperCase(); }' +
+    '    else { data[input.name] = input.value; }' +
+    '  }' +
+    '  location.href = "pebblejs://close#" + encodeURIComponent(JSON.stringify(data));' +
+    '}';
+
+function escapeHtml(text) {
+    return String(text).replace(/&/g, '&amp;').replace(/</g, '&lt;')
+        .replace(/>/g, '&gt;').replace(/"/g, '&quot;');
+}
+
+function configField(field, value) {
+    var name = field[0];
+    var label = '<label for="' + name + '">' + escapeHtml(field[1]) + '</label>';
+    switch (field[2]) {
+        case 'checkbox':
+            return '<p><input type="checkbox" id="' + name + '" name="' + name + '"' +
+                (parse(value) ? ' checked' : '') + '> ' + label + '</p>';
+        case 'color':
+            return '<p>' + label + ' <input type="color" id="' + name + '" name="' + name +
+                '" value="#' + String(value).replace(/^0x/, '').toLowerCase() + '"></p>';
+        case 'select':
+            return '<p>' + label + '<br><select id="' + name + '" name="' + name + '">' +
+                field[3].map(function(option) {
+                    return '<option value="' + escapeHtml(option[0]) + '"' +
+                        (String(option[0]) === String(value) ? ' selected' : '') + '>' +
+                        escapeHtml(option[1]) + '</option>';
+                }).join('') + '</select></p>';
+        default:
+            return '<p>' + label + '<br><input type="text" id="' + name + '" name="' + name +
+                '" value="' + escapeHtml(value) + '"></p>';
+    }
+}
+
+function configPage(settings) {
+    var platform = Pebble.getActiveWatchInfo ? Pebble.getActiveWatchInfo().platform : '';
+    return '<!DOCTYPE html><html><head><meta charset="utf-8">' +
+        '<meta name="viewport" content="width=device-width, initial-scale=1">' +
+        '<title>Timeboxed</title><style>' +
+        'body{font-family:sans-serif;margin:0 16px 32px;background:#333;color:#fff}' +
+        'h2{font-size:16px;margin:24px 0 8px;color:#ff5500}' +
+        'select,input[type=text]{width:100%;font-size:16px;margin-top:4px}' +
+        'button{width:100%;font-size:18px;padding:12px;margin-top:24px}' +
+        '</style></head><body><h1>Timeboxed ' + currentVersion + '</h1><form onsubmit="save(); return false;">' +
+        CONFIG_SECTIONS.filter(function(section) {
+            // aplite has no health and shows colors as black and white
+            return platform !== 'aplite' || (section[0] !== 'Health' && section[0] !== 'Colors');
+        }).map(function(section) {
+            return '<h2>' + section[0] + '</h2>' + section[1].map(function(field) {
+                return configField(field, field[0] in settings ? settings[field[0]] : CONFIG_DEFAULTS[field[0]]);
+            }).join('');
+        }).join('') +
+        '<button type="submit">Save</button></form><script>' + CONFIG_PAGE_SCRIPT + '</script></body></html>';
+}
+
+// the last saved page; installs from before it was kept start from what the
+// phone side already stored
+function savedSettings() {
+    if (localStorage.settings) {
+        return JSON.parse(localStorage.settings);
+    }
+    var settings = {};
+    ['weatherKey', 'forecastKey', 'overrideLocation', 'weatherProvider', 'useCelsius'].forEach(function(name) {
+        if (localStorage[name] !== undefined && localStorage[name] !== 'undefined') {
+            settings[name] = localStorage[name];
+        }
+    });
+    if (localStorage.weatherEnabled !== undefined && localStorage.weatherEnabled !== 'undefined') {
+        settings.enableWeather = localStorage.weatherEnabled;
+    }
+    JSON.parse(localStorage.worldClocks || '[]').forEach(function(worldClock, index) {
+        var name = WORLD_CLOCK_KEYS[index].replace('KEY_', '').toLowerCase();
+        var hours = worldClock.offset < 0 ? Math.ceil(worldClock.offset / 60) : Math.floor(worldClock.offset / 60);
+        settings[name] = (worldClock.code || '#') + '|' + hours + ':' + Math.abs(worldClock.offset % 60);
+    });
+    return settings;
+}
+
 Pebble.addEventListener('showConfiguration', function(e) {
-    Pebble.openURL(
-        'http://www.lbento.space/pebble-apps/timeboxed/config/?v=' + currentVersion +
-        '&p=' + Pebble.getActiveWatchInfo().platform +
-        '&l=' + Pebble.getActiveWatchInfo().language)
+    var settings = savedSettings();
+    Pebble.openURL('data:text/html;charset=utf-8,' + encodeURIComponent(configPage(settings)));
 });
 
 Pebble.addEventListener('webviewclosed', function(e) {
@@ -57,6 +337,8 @@ Pebble.addEventListener('webviewclosed', function(e) {
     }
     var configData = JSON.parse(decodeURIComponent(e.response));
     console.log(JSON.stringify(configData));
+    // pre-fills the page the next time it opens
+    localStorage.settings = JSON.stringify(configData);
 
     var dict = {};
 
@@ -74,7 +356,7 @@ Pebble.addEventListener('webviewclosed', function(e) {
         }
         if (key === 'KEY_FONTTYPE' || key === 'KEY_DATEFORMAT' || key === 'KEY_LOCALE' ||
                 key === 'KEY_TEXTALIGN' || key === 'KEY_WEATHERPROVIDER' || key.indexOf('SLOT') !== -1 ||
-                key === 'KEY_SPEEDUNIT') {
+                key === 'KEY_SPEEDUNIT' || key.indexOf('HEALTHLOG') !== -1) {
             value = parseInt(value, 10);
         }
         dict[key] = value;
@@ -86,14 +368,31 @@ Pebble.addEventListener('webviewclosed', function(e) {
     localStorage.overrideLocation = dict.KEY_OVERRIDELOCATION;
     localStorage.weatherProvider = dict.KEY_WEATHERPROVIDER;
     localStorage.forecastKey = dict.KEY_FORECASTKEY;
+    var previousClocks = localStorage.worldClocks ? JSON.parse(localStorage.worldClocks) : [];
+    localStorage.worldClocks = JSON.stringify(WORLD_CLOCK_KEYS.map(function(key) {
+        var hours = dict[key] || 0;
+        return {
+            code: dict[key + 'CODE'] || '',
+            offset: hours * 60 + (hours >= 0 ? 1 : -1) * (dict[key + 'MINUTES'] || 0)
+        };
+    }));
+    // the watch keeps the table of a zone that didn't change
+    var changedClocks = JSON.parse(localStorage.worldClocks).map(function(clock, index) {
+        var previous = previousClocks[index];
+        return !previous || previous.code !== clock.code || previous.offset !== clock.offset ? index : -1;
+    }).filter(function(index) {
+        return index >= 0;
+    });
 
     delete dict.KEY_WEATHERKEY;
     delete dict.KEY_WEATHERPROVIDER;
     delete dict.KEY_OVERRIDELOCATION;
     delete dict.KEY_FORECASTKEY;
     
-    Pebble.sendAppMessage(dict, function() {
+    sendMessage('config', dict, function() {
 	console.log('Send config successful: ' + JSON.stringify(dict));
+	// on its own, the config alone nearly fills the watch inbox
+	sendTimezoneTransitions(changedClocks);
     }, function() {
 	console.log('Send failed!');
     });
@@ -166,7 +465,9 @@ function executeYahooQuery(pos, useCelsius, woeid, overrideLocation) {
                 console.log('Yahoo weather failed, falling back to open weather');
                 fetchOpenWeatherMapData(pos, useCelsius, overrideLocation);
             }
-        });
+        }, {onError: function() {
+            fetchOpenWeatherMapData(pos, useCelsius, overrideLocation);
+        }});
     } else {
         console.log('No woeid found, falling back to open weather');
         fetchOpenWeatherMapData(pos, useCelsius, overrideLocation);
@@ -217,7 +518,9 @@ function getWoeidAndExecuteQuery(pos, useCelsius) {
             console.log('woeid query failed');
             executeYahooQuery(pos, useCelsius, '');
         }
-    });
+    }, {onError: function() {
+        executeYahooQuery(pos, useCelsius, '');
+    }});
 }
 
 function fetchWeatherUndergroundData(pos, weatherKey, useCelsius, overrideLocation) {
@@ -256,7 +559,9 @@ function fetchWeatherUndergroundData(pos, weatherKey, useCelsius, overrideLocati
             console.log('Falling back to Yahoo');
             fetchYahooData(pos, useCelsius, overrideLocation);
         }
-    });
+    }, {onError: function() {
+        fetchYahooData(pos, useCelsius, overrideLocation);
+    }});
 }
 
 function fetchForecastApiData(pos, weatherKey, useCelsius, overrideLocation) {
@@ -296,9 +601,9 @@ function findLocationAndExecuteQuery(weatherKey, useCelsius, overrideLocation) {
             console.log('Falling back to Yahoo');
             fetchYahooData(pos, useCelsius, overrideLocation);
         }
-    });
-
-
+    }, {onError: function() {
+        fetchYahooData(pos, useCelsius, overrideLocation);
+    }});
 }
 
 function executeForecastQuery(pos, weatherKey, useCelsius, overrideLocation) {
@@ -331,8 +636,9 @@ function executeForecastQuery(pos, weatherKey, useCelsius, overrideLocation) {
             console.log('Falling back to Yahoo');
             fetchYahooData(pos, useCelsius, overrideLocation);
         }
-
-    });
+    }, {onError: function() {
+        fetchYahooData(pos, useCelsius, overrideLocation);
+    }});
 }
 
 function fetchOpenWeatherMapData(pos, useCelsius, overrideLocation) {
@@ -409,12 +715,37 @@ function checkForUpdates() {
             console.log(ex);
             sendUpdateData(false);
         }
+    }, {onError: function() {
+        // the watch keeps what the last check found
+    }});
+}
+
+// a batch the watch sent again because our answer got lost is skipped
+function storeHealthRecords(bytes) {
+    var history = JSON.parse(localStorage.healthHistory || '[]');
+    var recent = history.slice(-64).map(function(record) {
+        return record[0] + ':' + record[1];
     });
+    var added = 0;
+    for (var offset = 0; offset + HEALTH_RECORD_SIZE <= bytes.length; offset += HEALTH_RECORD_SIZE) {
+        var start = (bytes[offset] | bytes[offset + 1] << 8 | bytes[offset + 2] << 16 | bytes[offset + 3] << 24) >>> 0;
+        var type = bytes[offset + 4];
+        if (!HEALTH_RECORD_TYPES[type] || recent.indexOf(start + ':' + type) !== -1) {
+            continue;
+        }
+        history.push([start, type,
+                      bytes[offset + 6] | bytes[offset + 7] << 8,
+                      bytes[offset + 8] | bytes[offset + 9] << 8,
+                      bytes[offset + 10] | bytes[offset + 11] << 8]);
+        added++;
+    }
+    localStorage.healthHistory = JSON.stringify(history.slice(-HEALTH_HISTORY_LIMIT));
+    console.log('Stored ' + added + ' health records, ' + Math.min(history.length, HEALTH_HISTORY_LIMIT) + ' kept');
 }
 
 function sendUpdateData(updateAvailable) {
     console.log(updateAvailable ? 'Update available!' : 'No updates.');
-    Pebble.sendAppMessage({'KEY_HASUPDATE': updateAvailable},
+    sendMessage('update', {'KEY_HASUPDATE': updateAvailable},
         function(e) {
             console.log('Sent update data to Pebble successfully!');
         },
@@ -424,6 +755,83 @@ function sendUpdateData(updateAvailable) {
     );
 }
 
+function nthSunday(year, month, nth) {
+    var day;
+    if (nth > 0) {
+        day = 1 + (7 - new Date(Date.UTC(year, month, 1)).getUTCDay()) % 7 + (nth - 1) * 7;
+    } else {
+        var last = new Date(Date.UTC(year, month + 1, 0));
+        day = last.getUTCDate() - last.getUTCDay();
+    }
+    return Date.UTC(year, month, day) / 1000;
+}
+
+function transitionTime(year, change, utc, offsetBefore) {
+    var at = nthSunday(year, change[0], change[1]) + change[2] * 60;
+    return utc ? at : at - offsetBefore * 60;
+}
+
+// UTC offsets (in minutes) of the zone, as the watch expects them: the one
+// in effect now, then the next transitions. Nothing for zones without DST.
+function timezoneTransitions(code, offset) {
+    var zone = TIMEZONE_RULES[(code || '').toUpperCase()];
+    if (!zone) {
+        return null;
+    }
+    var rule = DST_RULES[zone[0]];
+    var standard = zone[1] ? offset - 60 : offset;
+    var daylight = standard + 60;
+    var now = Date.now() / 1000;
+    var year = new Date().getUTCFullYear();
+
+    var changes = [];
+    for (var y = year - 1; y <= year + 3; y++) {
+        changes.push({at: transitionTime(y, rule.start, rule.utc, standard), offset: daylight});
+        changes.push({at: transitionTime(y, rule.end, rule.utc, daylight), offset: standard});
+    }
+    changes.sort(function(a, b) { return a.at - b.at; });
+
+    var current = 0;
+    while (current + 1 < changes.length && changes[current + 1].at <= now) {
+        current++;
+    }
+
+    var bytes = [];
+    changes.slice(current, current + TZ_TRANSITIONS).forEach(function(change) {
+        bytes.push(change.at & 0xff, (change.at >> 8) & 0xff, (change.at >> 16) & 0xff, (change.at >> 24) & 0xff);
+        bytes.push(change.offset & 0xff, (change.offset >> 8) & 0xff);
+    });
+    return bytes;
+}
+
+// one clock at a time, the watch takes a single message per round trip
+function sendTimezoneTransitions(clocks) {
+    if (!clocks.length) {
+        return;
+    }
+    var worldClock = JSON.parse(localStorage.worldClocks || '[]')[clocks[0]];
+    var transitions = worldClock && timezoneTransitions(worldClock.code, worldClock.offset);
+    var next = function() {
+        sendTimezoneTransitions(clocks.slice(1));
+    };
+    if (!transitions) {
+        next();
+        return;
+    }
+    var dict = {};
+    dict[TZ_TRANSITION_KEYS[clocks[0]]] = transitions;
+    sendMessage('transitions' + clocks[0], dict,
+        function(e) {
+            console.log('Sent timezone transitions to Pebble successfully!');
+            next();
+        },
+        function(e) {
+            console.log('Error sending timezone transitions to Pebble!');
+            next();
+        }
+    );
+}
+
 function kelvinToCelsius(temp) {
     return Math.round(temp - 273.15);
 }
@@ -445,7 +853,7 @@ function sendData(temp, max, min, condition, feels, speed, direction) {
 
     console.log(JSON.stringify(data));
 
-    Pebble.sendAppMessage(data,
+    sendMessage('weather', data,
         function(e) {
             console.log('Weather info sent to Pebble successfully!');
         },
@@ -479,23 +887,315 @@ function getWeather(provider, weatherKey, useCelsius, overrideLocation) {
 }
 
 
-var xhrRequest = function (url, type, callback) {
+function loadHttpCache() {
+    try {
+        return JSON.parse(localStorage.httpCache || '[]');
+    } catch (ex) {
+        return [];
+    }
+}
+
+function cachedResponse(url) {
+    var cache = loadHttpCache();
+    for (var i = 0; i < cache.length; i++) {
+        if (cache[i].url === url) {
+            return cache[i];
+        }
+    }
+    return null;
+}
+
+// most recent first, a response without validators drops the old entry
+function storeResponse(url, xhr, cached) {
+    var etag = xhr.getResponseHeader('ETag');
+    var modified = xhr.getResponseHeader('Last-Modified');
+    var text = xhr.responseText;
+    if (!cached && !etag && !modified) {
+        return;
+    }
+    var cache = loadHttpCache().filter(function(entry) {
+        return entry.url !== url;
+    });
+    if ((etag || modified) && text.length <= CACHE_MAX_LENGTH) {
+        cache.unshift({url: url, etag: etag, modified: modified, text: text});
+    }
+    localStorage.httpCache = JSON.stringify(cache.slice(0, CACHE_ENTRIES));
+}
+
+// callback gets the response text, a 304 the cached one. Failures, timeouts
+// and responses that are too long go to options.onError, sendError by
+// default, so the watch isn't left waiting
+var xhrRequest = function (url, type, callback, options) {
+    options = options || {};
+    var onError = options.onError || sendError;
+    var timeout = options.timeout || REQUEST_TIMEOUT;
+    var cached = type === 'GET' && options.conditional !== false ? cachedResponse(url) : null;
     var xhr = new XMLHttpRequest();
-    xhr.onload = function () {
-        callback(this.responseText);
+    var finished = false;
+    var timer;
+
+    var finish = function(error, text) {
+        if (finished) {
+            return;
+        }
+        finished = true;
+        clearTimeout(timer);
+        if (error) {
+            console.log('Request failed, ' + error + ': ' + url);
+            onError(error);
+        } else {
+            callback(text);
+        }
+    };
+
+    var abort = function(error) {
+        finish(error);
+        xhr.abort();
+    };
+
+    timer = setTimeout(function() {
+        abort('no response after ' + timeout + 'ms');
+    }, timeout);
+
+    xhr.onreadystatechange = function() {
+        // HEADERS_RECEIVED, too long a body isn't downloaded at all
+        if (xhr.readyState === 2 && parseInt(xhr.getResponseHeader('Content-Length'), 10) > REQUEST_MAX_LENGTH) {
+            abort('response of ' + xhr.getResponseHeader('Content-Length') + ' bytes');
+        }
+    };
+    xhr.onload = function() {
+        if (xhr.status === 304 && cached) {
+            console.log('Not modified: ' + url);
+            finish(null, cached.text);
+        } else if (xhr.status < 200 || xhr.status >= 300) {
+            finish('status ' + xhr.status);
+        } else if (xhr.responseText.length > REQUEST_MAX_LENGTH) {
+            finish('response of ' + xhr.responseText.length + ' characters');
+        } else {
+            if (type === 'GET' && options.conditional !== false) {
+                storeResponse(url, xhr, cached);
+            }
+            finish(null, xhr.responseText);
+        }
+    };
+    xhr.onerror = function() {
+        finish('network error');
     };
 
     try {
         xhr.open(type, url);
+        if (cached && cached.etag) {
+            xhr.setRequestHeader('If-None-Match', cached.etag);
+        }
+        if (cached && cached.modified) {
+            xhr.setRequestHeader('If-Modified-Since', cached.modified);
+        }
         xhr.send();
     } catch (ex) {
         console.log(ex);
-        sendError();
+        finish('exception ' + ex);
+    }
+};
+
+// the outbound queue. Messages of the same kind carry the same state, so a
+// newer one replaces a queued one, e.g. the weather and the empty state,
+// keeping its place in the line. Only the head is ever in flight
+var sendQueue = [];
+var sending = false;
+
+function sendMessage(kind, dict, onSuccess, onFailure) {
+    for (var i = sending ? 1 : 0; i < sendQueue.length; i++) {
+        if (sendQueue[i].kind === kind) {
+            console.log('Superseded queued ' + kind + ' message');
+            sendQueue[i].dict = dict;
+            sendQueue[i].onSuccess = onSuccess;
+            sendQueue[i].onFailure = onFailure;
+            return;
+        }
     }
+    sendQueue.push({kind: kind, dict: dict, onSuccess: onSuccess, onFailure: onFailure,
+                    queued: Date.now(), retries: 0});
+    sendNextMessage();
+}
+
+function sendNextMessage() {
+    if (sending || sendQueue.length === 0) {
+        return;
+    }
+    sending = true;
+    var message = sendQueue[0];
+    var done = function(sent, e) {
+        var callback = sent ? message.onSuccess : message.onFailure;
+        console.log('Message ' + message.kind + ' ' + (sent ? 'sent' : 'dropped') +
+                    ' after ' + (Date.now() - message.queued) + 'ms, ' + message.retries + ' retries');
+        sendQueue.shift();
+        sending = false;
+        if (callback) {
+            callback(e);
+        }
+        sendNextMessage();
+    };
+    Pebble.sendAppMessage(message.dict, function(e) {
+        done(true, e);
+    }, function(e) {
+        if (message.retries >= SEND_RETRIES) {
+            done(false, e);
+            return;
+        }
+        // stays at the head, so nothing overtakes it meanwhile
+        setTimeout(function() {
+            message.retries++;
+            sending = false;
+            sendNextMessage();
+        }, SEND_RETRY_MS << message.retries);
+    });
+}
+
+var requestDiagnostics = function(type) {
+    var dict = {'KEY_DIAGNOSTICS': type || DIAGNOSTICS_MEMORY};
+    if (type === DIAGNOSTICS_ENERGY && localStorage.energyCosts) {
+        dict.KEY_ENERGYCOSTS = packEnergyCosts(JSON.parse(localStorage.energyCosts));
+    }
+    sendMessage('diagnostics' + type, dict,
+        function(e) {
+            console.log('Requested diagnostics ' + type + ' from Pebble');
+        },
+        function(e) {
+            console.log('Error requesting diagnostics from Pebble!');
+        }
+    );
 };
 
+function logDiagnostics(payload) {
+    switch (payload.KEY_DIAGNOSTICS) {
+        case DIAGNOSTICS_PROFILE:
+            logProfileReport(payload.KEY_PROFILE || []);
+            break;
+        case DIAGNOSTICS_ENERGY:
+            logEnergyReport(payload.KEY_ENERGY || []);
+            break;
+        default:
+            console.log('Unknown diagnostics report ' + payload.KEY_DIAGNOSTICS);
+    }
+}
+
+function bucketLabel(bucket) {
+    if (bucket < PROFILE_BUCKET_LIMITS.length) {
+        return '<' + PROFILE_BUCKET_LIMITS[bucket] + 'ms';
+    }
+    return '>=' + PROFILE_BUCKET_LIMITS[PROFILE_BUCKET_LIMITS.length - 1] + 'ms';
+}
+
+function percentileBucket(counts, total, fraction) {
+    var seen = 0;
+    for (var bucket = 0; bucket < counts.length; bucket++) {
+        seen += counts[bucket];
+        if (seen >= total * fraction) {
+            return bucketLabel(bucket);
+        }
+    }
+    return '-';
+}
+
+function logProfileReport(data) {
+    // per path: one little endian uint16 per bucket, then the slowest run
+    var values = PROFILE_BUCKET_LIMITS.length + 2;
+    for (var path = 0; path < PROFILE_PATHS.length; path++) {
+        var counts = [];
+        var total = 0;
+        for (var i = 0; i < values; i++) {
+            var offset = (path * values + i) * 2;
+            counts.push((data[offset] || 0) | ((data[offset + 1] || 0) << 8));
+        }
+        var slowest = counts.pop();
+        for (var bucket = 0; bucket < counts.length; bucket++) {
+            total += counts[bucket];
+        }
+        if (!total) {
+            console.log(PROFILE_PATHS[path] + ': no samples');
+            continue;
+        }
+        console.log(PROFILE_PATHS[path] + ': ' + total + ' runs, p50 ' + percentileBucket(counts, total, 0.5) +
+            ', p99 ' + percentileBucket(counts, total, 0.99) + ', max ' + slowest + 'ms [' + counts.join(' ') + ']');
+    }
+}
+
+// [per event, per thousand units] in microamp seconds for each of
+// ENERGY_EVENTS, as little endian uint32
+function packEnergyCosts(costs) {
+    var bytes = [];
+    ENERGY_EVENTS.forEach(function(name, event) {
+        (costs[event] || [0, 0]).forEach(function(cost) {
+            bytes.push(cost & 0xFF, cost >>> 8 & 0xFF, cost >>> 16 & 0xFF, cost >>> 24 & 0xFF);
+        });
+    });
+    return bytes;
+}
+
+function readUint32(data, offset) {
+    return ((data[offset] || 0) | (data[offset + 1] || 0) << 8 | (data[offset + 2] || 0) << 16 |
+            (data[offset + 3] || 0) << 24) >>> 0;
+}
+
+// the saved settings without the API keys and the location, hashed
+function settingsSignature() {
+    var settings = savedSettings();
+    var text = Object.keys(settings).sort().filter(function(name) {
+        return !/Key$/.test(name) && name !== 'overrideLocation';
+    }).map(function(name) {
+        return name + '=' + settings[name];
+    }).join('&');
+    var hash = 5381;
+    for (var i = 0; i < text.length; i++) {
+        hash = (hash * 33 + text.charCodeAt(i)) >>> 0;
+    }
+    return ('0000000' + hash.toString(16)).slice(-8);
+}
+
+// The daily charge by subsystem, kept in localStorage.energyReports for the
+// last ENERGY_REPORTS_KEPT settings so their costs can be compared.
+function logEnergyReport(data) {
+    // the seconds counted, then per event its count, amount and daily charge
+    var hours = Math.round(readUint32(data, 0) / 360) / 10;
+    var subsystems = {};
+    var total = 0;
+    ENERGY_EVENTS.forEach(function(name, event) {
+        var offset = 4 + event * 12;
+        var charge = readUint32(data, offset + 8);
+        console.log(name + ': ' + readUint32(data, offset) + ' times, ' + readUint32(data, offset + 4) +
+            ' units, ' + charge + ' uAh/day');
+        subsystems[ENERGY_SUBSYSTEMS[event]] = (subsystems[ENERGY_SUBSYSTEMS[event]] || 0) + charge;
+        total += charge;
+    });
+
+    var current = settingsSignature();
+    var reports = JSON.parse(localStorage.energyReports || '{}');
+    reports[current] = {time: Date.now(), hours: hours, total: total, subsystems: subsystems};
+    var signatures = Object.keys(reports).sort(function(a, b) {
+        return reports[a].total - reports[b].total;
+    });
+    Object.keys(reports).sort(function(a, b) {
+        return reports[b].time - reports[a].time;
+    }).slice(ENERGY_REPORTS_KEPT).forEach(function(signature) {
+        delete reports[signature];
+    });
+    localStorage.energyReports = JSON.stringify(reports);
+
+    console.log('Energy by settings, estimated uAh/day:');
+    signatures.forEach(function(signature) {
+        var report = reports[signature];
+        if (!report) {
+            return;
+        }
+        console.log((signature === current ? '* ' : '  ') + signature + ': ' + report.total + ' (' +
+            Object.keys(report.subsystems).map(function(name) {
+                return name + ' ' + report.subsystems[name];
+            }).join(', ') + ') over ' + report.hours + ' h');
+    });
+}
+
 var sendError = function() {
-    Pebble.sendAppMessage({'KEY_ERROR': true},
+    sendMessage('weather', {'KEY_ERROR': true},
         function(e) {
             console.log('Sent empty state to Pebble successfully!');
         },
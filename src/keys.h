@@ -71,6 +71,33 @@
 #define KEY_SLEEPBEHINDCOLOR 67
 #define KEY_DEEPCOLOR 68
 #define KEY_DEEPBEHINDCOLOR 69
+#define KEY_DIAGNOSTICS 70
+#define KEY_PROFILE 71
+#define KEY_TZTRANSITIONS 72
+#define KEY_TIMEZONES2 73
+#define KEY_TIMEZONES2CODE 74
+#define KEY_TIMEZONES2MINUTES 75
+#define KEY_TIMEZONES3 76
+#define KEY_TIMEZONES3CODE 77
+#define KEY_TIMEZONES3MINUTES 78
+#define KEY_TZTRANSITIONS2 79
+#define KEY_TZTRANSITIONS3 80
+#define KEY_SNAPSHOT 81
+#define KEY_HEALTHLOG 82
+#define KEY_HEALTHLOGRECORDS 83
+#define KEY_HEALTHBATCH 84
+#define KEY_ENERGY 85
+#define KEY_ENERGYCOSTS 86
+#define KEY_COUNT 87
+
+#define TZ_NAME_LEN 12 // timezone code, fits the alt time text with the +1 suffix
+#define TZ_TRANSITIONS 6 // offset now plus the next transitions, about 2.5 years
+#define TZ_TRANSITION_SIZE 6 // int32 UTC time, int16 offset in minutes, little endian
+#define TZ_TRANSITIONS_LOW 2 // ask the phone for more below this many upcoming
+#define WORLD_CLOCKS 3 // the alt time, then the clocks shown in slots
+#define WORLD_CLOCK_TEXT_LEN 22 // 12:00PM+1 and a space before the code
+#define HEALTH_TEXT_LEN 10 // 99999 cal, the longest health text
+#define HEALTH_RECORD_SIZE 12 // int32 UTC start, type, 0, three uint16 values, little endian
 
 #define FLAG_WEATHER 0x0001
 #define FLAG_HEALTH 0x0002
@@ -118,6 +145,7 @@
 #define SLOT_B 1
 #define SLOT_C 2
 #define SLOT_D 3
+#define SLOT_COUNT 4
 
 #define MODULE_NONE -1
 #define MODULE_WEATHER 1
@@ -130,6 +158,9 @@
 #define MODULE_WIND 8
 #define MODULE_FEELS 9
 #define MODULE_WEATHER_FEELS 10
+#define MODULE_TIMEZONE2 11
+#define MODULE_TIMEZONE3 12
+#define MODULE_COUNT 13 // ids run up to MODULE_TIMEZONE3
 
 #define MODE_NORMAL 0
 #define MODE_SIMPLE 1
@@ -146,9 +177,18 @@
 #define SPEED_ITEM 9
 #define DIRECTION_ITEM 10
 #define WIND_UNIT_ITEM 11
+#define TIMEZONE_ITEM 12
 
 #define UNIT_MPH 0
 #define UNIT_KPH 1
 #define UNIT_KNOTS 2
 
+#define DIAGNOSTICS_MEMORY 1
+#define DIAGNOSTICS_PROFILE 2
+#define DIAGNOSTICS_STORAGE 3
+#define DIAGNOSTICS_POWER 4
+#define DIAGNOSTICS_SCHEDULER 5
+#define DIAGNOSTICS_HEALTHLOG 6
+#define DIAGNOSTICS_ENERGY 7
+
 #endif
@@ -0,0 +1,116 @@
+#include <pebble.h>
+#include "memory.h"
+
+#if defined(TIMEBOXED_INSTRUMENT)
+
+struct PhaseStats {
+    uint16_t used_before;
+    uint16_t used_after;
+    uint16_t free_before;
+    uint16_t free_after;
+    uint16_t peak_used;
+    uint8_t runs;
+};
+
+// The stack below a handler is painted when it starts and scanned for the
+// deepest overwritten word when it ends, so the depth covers everything it
+// called, not just its own frame.
+#if !defined(STACK_PAINT_WORDS)
+#define STACK_PAINT_WORDS 256 // 1 KB, below the frames of the event loop
+#endif
+#define STACK_PAINT 0x5AC35AC3
+
+static struct PhaseStats phases[PHASE_COUNT];
+static uint16_t stack_depth[STACK_SAMPLE_COUNT];
+static bool stack_exhausted[STACK_SAMPLE_COUNT]; // went past the painted words
+static uintptr_t stack_base;
+static uintptr_t painted_bottom;
+
+static const char* phase_names[PHASE_COUNT] = {
+    "init", "layers", "fonts", "health", "weather", "config"
+};
+
+static const char* stack_names[STACK_SAMPLE_COUNT] = {
+    "inbox", "tick"
+};
+
+static const char* get_platform_name() {
+    #if defined(PBL_PLATFORM_APLITE)
+    return "aplite";
+    #elif defined(PBL_PLATFORM_BASALT)
+    return "basalt";
+    #elif defined(PBL_PLATFORM_CHALK)
+    return "chalk";
+    #else
+    return "unknown";
+    #endif
+}
+
+void init_memory_stats() {
+    // anything called from the event loop runs deeper than this frame
+    volatile uint8_t marker = 0;
+    stack_base = (uintptr_t)&marker;
+}
+
+void memory_phase_begin(int phase) {
+    phases[phase].used_before = heap_bytes_used();
+    phases[phase].free_before = heap_bytes_free();
+}
+
+void memory_phase_end(int phase) {
+    struct PhaseStats *stats = &phases[phase];
+    stats->used_after = heap_bytes_used();
+    stats->free_after = heap_bytes_free();
+    if (stats->used_after > stats->peak_used) {
+        stats->peak_used = stats->used_after;
+    }
+    if (stats->runs < UINT8_MAX) {
+        stats->runs++;
+    }
+}
+
+// the words stay below the caller's frame once this returns
+void __attribute__((noinline)) stack_sample_begin() {
+    volatile uint32_t paint[STACK_PAINT_WORDS];
+    for (int i = 0; i < STACK_PAINT_WORDS; ++i) {
+        paint[i] = STACK_PAINT;
+    }
+    painted_bottom = (uintptr_t)paint;
+}
+
+void __attribute__((noinline)) stack_sample_end(int sample) {
+    const volatile uint32_t *paint = (const volatile uint32_t *)painted_bottom;
+    int untouched = 0;
+    while (untouched < STACK_PAINT_WORDS && paint[untouched] == STACK_PAINT) {
+        untouched++;
+    }
+    uintptr_t deepest = painted_bottom + untouched * sizeof(uint32_t);
+    uintptr_t depth = stack_base > deepest ? stack_base - deepest : 0;
+    if (depth > stack_depth[sample]) {
+        stack_depth[sample] = depth;
+    }
+    if (untouched == 0) {
+        stack_exhausted[sample] = true;
+    }
+}
+
+void log_memory_report() {
+    APP_LOG(APP_LOG_LEVEL_INFO, "Memory on %s: %d used, %d free",
+            get_platform_name(), (int)heap_bytes_used(), (int)heap_bytes_free());
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        struct PhaseStats *stats = &phases[i];
+        if (stats->runs == 0) {
+            continue;
+        }
+        APP_LOG(APP_LOG_LEVEL_INFO, "%s: used %d->%d (%d) free %d->%d peak %d x%d",
+                phase_names[i], stats->used_before, stats->used_after,
+                stats->used_after - stats->used_before, stats->free_before, stats->free_after,
+                stats->peak_used, stats->runs);
+    }
+    for (int i = 0; i < STACK_SAMPLE_COUNT; ++i) {
+        APP_LOG(APP_LOG_LEVEL_INFO, "stack %s: %d bytes%s", stack_names[i], stack_depth[i],
+                stack_exhausted[i] ? " or more" : "");
+    }
+}
+
+#endif
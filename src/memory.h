@@ -0,0 +1,34 @@
+#ifndef __TIMEBOXED_MEMORY_
+#define __TIMEBOXED_MEMORY_
+
+#include <pebble.h>
+
+#define PHASE_INIT 0
+#define PHASE_CREATE_LAYERS 1
+#define PHASE_LOAD_FONTS 2
+#define PHASE_TOGGLE_HEALTH 3
+#define PHASE_TOGGLE_WEATHER 4
+#define PHASE_APPLY_CONFIG 5
+#define PHASE_COUNT 6
+
+#define STACK_INBOX 0
+#define STACK_TICK 1
+#define STACK_SAMPLE_COUNT 2
+
+#if defined(TIMEBOXED_INSTRUMENT)
+void init_memory_stats();
+void memory_phase_begin(int phase);
+void memory_phase_end(int phase);
+void stack_sample_begin();
+void stack_sample_end(int sample);
+void log_memory_report();
+#else
+#define init_memory_stats()
+#define memory_phase_begin(phase)
+#define memory_phase_end(phase)
+#define stack_sample_begin()
+#define stack_sample_end(sample)
+#define log_memory_report() APP_LOG(APP_LOG_LEVEL_INFO, "Memory report needs a build with --instrument")
+#endif
+
+#endif
@@ -0,0 +1,188 @@
+#include <pebble.h>
+#include "modules.h"
+#include "keys.h"
+#include "text.h"
+#include "weather.h"
+#include "health.h"
+#include "storage.h"
+
+#define MODE_AWAKE 0
+#define MODE_ASLEEP 1
+
+// the hooks of the modules drawn with text layers, see text.c
+#define TEXT_HOOKS create_module_text_layers, layout_module_text_layers, place_module_text_layers
+
+// Every MODULE_* by id. The layers of all of them exist whether they are in
+// a slot or not, so the setters never need to check.
+static const struct Module registry[MODULE_COUNT] = {
+    [MODULE_WEATHER] = { TEXT_HOOKS, show_weather_module, destroy_module_text_layers, NULL, FAMILY_WEATHER },
+    [MODULE_FORECAST] = { TEXT_HOOKS, show_weather_module, destroy_module_text_layers, NULL, FAMILY_WEATHER },
+    [MODULE_WIND] = { TEXT_HOOKS, show_weather_module, destroy_module_text_layers, NULL, FAMILY_WEATHER },
+    #if defined(PBL_HEALTH)
+    [MODULE_STEPS] = { TEXT_HOOKS, update_health_module, destroy_module_text_layers,
+                       health_refresh_interval, FAMILY_HEALTH },
+    [MODULE_DIST] = { TEXT_HOOKS, update_health_module, destroy_module_text_layers,
+                      health_refresh_interval, FAMILY_HEALTH },
+    [MODULE_CAL] = { TEXT_HOOKS, update_health_module, destroy_module_text_layers,
+                     health_refresh_interval, FAMILY_HEALTH },
+    [MODULE_SLEEP] = { TEXT_HOOKS, update_health_module, destroy_module_text_layers,
+                       health_refresh_interval, FAMILY_HEALTH },
+    [MODULE_DEEP] = { TEXT_HOOKS, update_health_module, destroy_module_text_layers,
+                      health_refresh_interval, FAMILY_HEALTH },
+    #else
+    [MODULE_STEPS] = { .family = FAMILY_HEALTH },
+    [MODULE_DIST] = { .family = FAMILY_HEALTH },
+    [MODULE_CAL] = { .family = FAMILY_HEALTH },
+    [MODULE_SLEEP] = { .family = FAMILY_HEALTH },
+    [MODULE_DEEP] = { .family = FAMILY_HEALTH },
+    #endif
+    // updated with the time by update_time
+    [MODULE_TIMEZONE2] = { TEXT_HOOKS, NULL, destroy_module_text_layers, NULL, FAMILY_TIME },
+    [MODULE_TIMEZONE3] = { TEXT_HOOKS, NULL, destroy_module_text_layers, NULL, FAMILY_TIME },
+};
+
+// both directions precomputed for each mode, so no lookup scans the slots
+static int8_t module_slots[2][MODULE_COUNT];
+static uint8_t slot_modules[2][SLOT_COUNT];
+static uint8_t family_counts[2][FAMILY_TIME + 1];
+static bool modules_loaded;
+
+// the slot keys of a mode are consecutive, KEY_SLOTA to KEY_SLOTD
+static const uint32_t slot_keys[2] = { KEY_SLOTA, KEY_SLEEPSLOTA };
+
+static bool is_valid_module(int module) {
+    return module > 0 && module < MODULE_COUNT;
+}
+
+static void index_mode(int mode) {
+    memset(module_slots[mode], -1, sizeof(module_slots[mode]));
+    memset(family_counts[mode], 0, sizeof(family_counts[mode]));
+    // the first slot wins when a module is in more than one
+    for (int slot = SLOT_COUNT - 1; slot >= 0; --slot) {
+        int module = slot_modules[mode][slot];
+        if (is_valid_module(module)) {
+            module_slots[mode][module] = slot;
+        }
+    }
+    for (int module = 1; module < MODULE_COUNT; ++module) {
+        if (module_slots[mode][module] >= 0) {
+            family_counts[mode][registry[module].family]++;
+        }
+    }
+}
+
+void load_modules() {
+    for (int mode = MODE_AWAKE; mode <= MODE_ASLEEP; ++mode) {
+        for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+            slot_modules[mode][slot] = storage_read_int(slot_keys[mode] + slot);
+        }
+        index_mode(mode);
+    }
+    modules_loaded = true;
+}
+
+static int current_mode() {
+    if (!modules_loaded) {
+        load_modules();
+    }
+    return should_show_sleep_data() ? MODE_ASLEEP : MODE_AWAKE;
+}
+
+void set_module(int slot, int module, bool sleeping_mode) {
+    if (!modules_loaded) {
+        load_modules();
+    }
+    int mode = sleeping_mode ? MODE_ASLEEP : MODE_AWAKE;
+    slot_modules[mode][slot] = module;
+    index_mode(mode);
+}
+
+// in a slot of either mode: the layers of both are kept up to date, the
+// ones of the other mode hidden
+bool is_module_enabled(int module) {
+    if (!modules_loaded) {
+        load_modules();
+    }
+    return is_valid_module(module) &&
+            (module_slots[MODE_AWAKE][module] >= 0 || module_slots[MODE_ASLEEP][module] >= 0);
+}
+
+int get_module_for_slot(int slot) {
+    int module = slot_modules[current_mode()][slot];
+    return is_valid_module(module) ? module : MODULE_NONE;
+}
+
+bool is_family_enabled(int family) {
+    if (!modules_loaded) {
+        load_modules();
+    }
+    return family_counts[MODE_AWAKE][family] > 0 || family_counts[MODE_ASLEEP][family] > 0;
+}
+
+// the shortest interval of the family's modules in the slots, 0 for none
+uint8_t get_refresh_interval(int family) {
+    uint8_t interval = 0;
+    for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+        int module = get_module_for_slot(slot);
+        if (module == MODULE_NONE || registry[module].family != family || !registry[module].refresh_interval) {
+            continue;
+        }
+        uint8_t module_interval = registry[module].refresh_interval();
+        if (module_interval > 0 && (interval == 0 || module_interval < interval)) {
+            interval = module_interval;
+        }
+    }
+    return interval;
+}
+
+void create_module_layers(Layer *window_layer) {
+    for (int module = 1; module < MODULE_COUNT; ++module) {
+        if (registry[module].create) {
+            registry[module].create(module, window_layer);
+        }
+    }
+    layout_modules();
+    place_modules();
+}
+
+// where the layers go in the awake and in the asleep slots, once per config
+void layout_modules() {
+    if (!modules_loaded) {
+        load_modules();
+    }
+    for (int module = 1; module < MODULE_COUNT; ++module) {
+        if (registry[module].layout) {
+            registry[module].layout(module, module_slots[MODE_AWAKE][module], module_slots[MODE_ASLEEP][module]);
+        }
+    }
+}
+
+// on a switch between the two, only the precomputed frames are assigned
+void place_modules() {
+    bool asleep = current_mode() == MODE_ASLEEP;
+    for (int module = 1; module < MODULE_COUNT; ++module) {
+        if (registry[module].place) {
+            registry[module].place(module, asleep);
+        }
+    }
+}
+
+void destroy_module_layers() {
+    for (int module = 1; module < MODULE_COUNT; ++module) {
+        if (registry[module].destroy) {
+            registry[module].destroy(module);
+        }
+    }
+}
+
+// in slot order, each module once
+void update_modules(int family) {
+    int mode = current_mode();
+    for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+        int module = get_module_for_slot(slot);
+        if (module != MODULE_NONE && module_slots[mode][module] == slot &&
+                registry[module].family == family && registry[module].update) {
+            registry[module].update(module);
+        }
+    }
+}
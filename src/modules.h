@@ -0,0 +1,35 @@
+#ifndef __TIMEBOXED_MODULES_
+#define __TIMEBOXED_MODULES_
+
+#include <pebble.h>
+
+// where a module gets its data, modules of a family are refreshed together
+#define FAMILY_NONE 0
+#define FAMILY_WEATHER 1
+#define FAMILY_HEALTH 2
+#define FAMILY_TIME 3
+
+struct Module {
+    void (*create)(int module, Layer *window_layer); // creates its layers
+    void (*layout)(int module, int awake_slot, int asleep_slot); // computes where they go in both, -1 for none
+    void (*place)(int module, bool asleep); // moves them there, without allocating
+    void (*update)(int module); // shows its current values
+    void (*destroy)(int module);
+    uint8_t (*refresh_interval)(); // minutes between updates from the tick, NULL when event driven
+    uint8_t family;
+};
+
+void load_modules();
+void set_module(int slot, int module, bool sleeping_mode);
+bool is_module_enabled(int module);
+int get_module_for_slot(int slot);
+bool is_family_enabled(int family);
+uint8_t get_refresh_interval(int family);
+
+void create_module_layers(Layer *window_layer);
+void layout_modules();
+void place_modules();
+void destroy_module_layers();
+void update_modules(int family);
+
+#endif
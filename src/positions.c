@@ -104,6 +104,27 @@ void get_text_positions(int selected_font, GTextAlignment alignment, struct Text
     }
 };
 
+// While Quick View covers the bottom of the screen, the rows from the time
+// down to the battery row move up by this much, keeping their spacing. The
+// battery row and slots C and D under it are hidden.
+int get_peek_offset(int selected_font) {
+    switch(selected_font) {
+        case BLOCKO_FONT:
+            return PBL_IF_ROUND_ELSE(0, 4);
+        case BLOCKO_BIG_FONT:
+            return PBL_IF_ROUND_ELSE(2, 6);
+        case SYSTEM_FONT:
+            return PBL_IF_ROUND_ELSE(0, 4);
+        case ARCHIVO_FONT:
+            return PBL_IF_ROUND_ELSE(2, 6);
+        case DIN_FONT:
+            return PBL_IF_ROUND_ELSE(0, 3);
+        case PROTOTYPE_FONT:
+            return PBL_IF_ROUND_ELSE(0, 4);
+    }
+    return PBL_IF_ROUND_ELSE(0, 4);
+}
+
 static GPoint get_weather_positions(int mode, int font) {
     // weather condition
     switch (mode) {
@@ -418,6 +439,16 @@ static GPoint get_wind_unit_positions(int mode, int font) {
     return create_point(0, 0);
 };
 
+static GPoint get_timezone_positions(int mode, int font) {
+    // world clock, placed like the health texts
+    switch (mode) {
+        case MODE_NORMAL:
+            return create_point(0, 3);
+        default:
+            return create_point(0, 0);
+    }
+};
+
 GPoint get_slot_positions(int mode, int slot) {
     switch (mode) {
         case MODE_NORMAL:
@@ -485,6 +516,9 @@ GPoint get_pos_for_item(int slot, int item, int mode, int font) {
         case 11:
             item_pos = get_wind_unit_positions(mode, font);
             break;
+        case 12:
+            item_pos = get_timezone_positions(mode, font);
+            break;
     }
     return create_point(slot_pos.x + item_pos.x, slot_pos.y + item_pos.y);
 }
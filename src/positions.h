@@ -15,6 +15,7 @@ struct TextPositions {
 GPoint create_point(int x, int y);
 GPoint get_pos_for_item(int slot, int item, int mode, int font);
 void get_text_positions(int selected_font, GTextAlignment alignment, struct TextPositions* positions);
+int get_peek_offset(int selected_font);
 void init_positions();
 
 #endif
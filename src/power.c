@@ -0,0 +1,65 @@
+#include <pebble.h>
+#include "power.h"
+#include "health.h"
+
+static const struct PowerProfile profiles[POWER_PROFILE_COUNT] = {
+    [POWER_NORMAL] = { .weather_interval = 30, .health_interval = 2, .health_events = true, .update_checks = true },
+    [POWER_SAVER] = { .weather_interval = 60, .health_interval = 10, .health_events = true, .update_checks = true },
+    [POWER_CRITICAL] = { .weather_interval = 0, .health_interval = 30, .suppress_redraws = true },
+    [POWER_NIGHT] = { .weather_interval = 90, .health_interval = 10, .health_events = true, .update_checks = true },
+};
+
+static const char* profile_names[POWER_PROFILE_COUNT] = {
+    "normal", "saver", "critical", "night"
+};
+
+static uint8_t current_profile = POWER_NORMAL;
+static uint16_t profile_minutes[POWER_PROFILE_COUNT];
+static uint16_t profile_changes;
+
+static uint8_t select_profile(BatteryChargeState charge_state, bool sleeping) {
+    bool on_battery = !charge_state.is_charging && !charge_state.is_plugged;
+    if (on_battery && charge_state.charge_percent <= POWER_CRITICAL_PERCENT) {
+        return POWER_CRITICAL;
+    }
+    if (sleeping) {
+        return POWER_NIGHT;
+    }
+    if (on_battery && charge_state.charge_percent <= POWER_SAVER_PERCENT) {
+        return POWER_SAVER;
+    }
+    return POWER_NORMAL;
+}
+
+const struct PowerProfile *get_power_profile() {
+    return &profiles[current_profile];
+}
+
+void update_power_profile(BatteryChargeState charge_state, bool sleeping) {
+    uint8_t profile = select_profile(charge_state, sleeping);
+    if (profile == current_profile) {
+        return;
+    }
+    // logged at info level so the change shows up next to the battery level
+    APP_LOG(APP_LOG_LEVEL_INFO, "Power profile %s -> %s, battery %d%%%s",
+            profile_names[current_profile], profile_names[profile],
+            charge_state.charge_percent, charge_state.is_charging ? " charging" : "");
+    current_profile = profile;
+    if (profile_changes < UINT16_MAX) {
+        profile_changes++;
+    }
+    set_health_events_enabled(profiles[profile].health_events);
+}
+
+void count_power_minute() {
+    if (profile_minutes[current_profile] < UINT16_MAX) {
+        profile_minutes[current_profile]++;
+    }
+}
+
+void log_power_report() {
+    APP_LOG(APP_LOG_LEVEL_INFO, "Power: %s now, %d changes", profile_names[current_profile], profile_changes);
+    for (int i = 0; i < POWER_PROFILE_COUNT; ++i) {
+        APP_LOG(APP_LOG_LEVEL_INFO, "%s: %d minutes", profile_names[i], profile_minutes[i]);
+    }
+}
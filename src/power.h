@@ -0,0 +1,28 @@
+#ifndef __TIMEBOXED_POWER_
+#define __TIMEBOXED_POWER_
+
+#include <pebble.h>
+
+#define POWER_NORMAL 0
+#define POWER_SAVER 1
+#define POWER_CRITICAL 2
+#define POWER_NIGHT 3
+#define POWER_PROFILE_COUNT 4
+
+#define POWER_SAVER_PERCENT 30
+#define POWER_CRITICAL_PERCENT 10
+
+struct PowerProfile {
+    uint8_t weather_interval; // minutes, 0 stops the weather updates
+    uint8_t health_interval; // minutes between health refreshes, divides 60
+    bool health_events;
+    bool update_checks;
+    bool suppress_redraws; // keeps the layout instead of switching to the sleep slots
+};
+
+const struct PowerProfile *get_power_profile();
+void update_power_profile(BatteryChargeState charge_state, bool sleeping);
+void count_power_minute();
+void log_power_report();
+
+#endif
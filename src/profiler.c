@@ -0,0 +1,58 @@
+#include <pebble.h>
+#include "profiler.h"
+#include "keys.h"
+
+#if defined(TIMEBOXED_INSTRUMENT)
+
+static const uint16_t bucket_limits[PROFILE_BUCKETS - 1] = {
+    2, 5, 10, 20, 50, 100, 250
+};
+
+static uint16_t histograms[PROFILE_COUNT][PROFILE_BUCKETS];
+static uint16_t slowest[PROFILE_COUNT];
+
+uint32_t profile_begin() {
+    time_t seconds;
+    uint16_t millis;
+    time_ms(&seconds, &millis);
+    return (uint32_t)seconds * 1000 + millis;
+}
+
+void profile_end(int path, uint32_t start) {
+    uint32_t elapsed = profile_begin() - start;
+
+    int bucket = 0;
+    while (bucket < PROFILE_BUCKETS - 1 && elapsed >= bucket_limits[bucket]) {
+        bucket++;
+    }
+    if (histograms[path][bucket] < UINT16_MAX) {
+        histograms[path][bucket]++;
+    }
+    if (elapsed > slowest[path]) {
+        slowest[path] = elapsed > UINT16_MAX ? UINT16_MAX : elapsed;
+    }
+}
+
+void send_profile_report() {
+    // per path: the bucket counts followed by the slowest run, little endian
+    uint8_t packed[PROFILE_COUNT * (PROFILE_BUCKETS + 1) * 2];
+    uint8_t *pos = packed;
+    for (int path = 0; path < PROFILE_COUNT; ++path) {
+        for (int bucket = 0; bucket <= PROFILE_BUCKETS; ++bucket) {
+            uint16_t value = bucket < PROFILE_BUCKETS ? histograms[path][bucket] : slowest[path];
+            *pos++ = value & 0xFF;
+            *pos++ = value >> 8;
+        }
+    }
+
+    DictionaryIterator *iter;
+    if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Couldn't send profiler report");
+        return;
+    }
+    dict_write_uint8(iter, KEY_DIAGNOSTICS, DIAGNOSTICS_PROFILE);
+    dict_write_data(iter, KEY_PROFILE, packed, sizeof(packed));
+    app_message_outbox_send();
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef __TIMEBOXED_PROFILER_
+#define __TIMEBOXED_PROFILER_
+
+#include <pebble.h>
+
+#define PROFILE_TICK 0
+#define PROFILE_UPDATE_TIME 1
+#define PROFILE_HEALTH 2
+#define PROFILE_INBOX 3
+#define PROFILE_LOAD_SCREEN 4
+#define PROFILE_RENDER 5
+#define PROFILE_COUNT 6
+
+// latency buckets: <2, <5, <10, <20, <50, <100, <250 and 250+ ms
+#define PROFILE_BUCKETS 8
+
+#if defined(TIMEBOXED_INSTRUMENT)
+uint32_t profile_begin();
+void profile_end(int path, uint32_t start);
+void send_profile_report();
+#else
+#define profile_begin() 0
+#define profile_end(path, start) ((void)(start))
+#define send_profile_report() APP_LOG(APP_LOG_LEVEL_INFO, "Profiler needs a build with --instrument")
+#endif
+
+#endif
@@ -0,0 +1,220 @@
+#include <pebble.h>
+#include "scheduler.h"
+
+// All the periodic work runs from here. The minute tick runs whatever is
+// due, and a single app timer covers the deadlines that can't wait for the
+// next tick. A task may run up to its jitter late, so the ones that can wait
+// join the next batch instead of waking the watch on their own.
+// Time and date are formatted before the batch and never wait. A batch
+// starts no task after BATCH_BUDGET_MS, the ones left over run in the next
+// slice, so a busy minute doesn't hold the UI thread for all of its work.
+#define BATCH_BUDGET_MS 20
+
+#define TIMING_ONCE 0
+#define TIMING_ALIGNED 1 // to the local time of day
+#define TIMING_RELATIVE 2 // to its last run
+
+struct Task {
+    TaskCallback callback;
+    void *context;
+    time_t due; // 0 when not scheduled
+    time_t last_run;
+    uint32_t period; // seconds
+    uint32_t phase;
+    uint16_t jitter;
+    uint8_t timing;
+    uint16_t runs;
+    uint16_t duration; // ms, of the last run
+};
+
+static const char* task_names[TASK_COUNT] = {
+    "sleep status", "power", "update check", "sleep data", "wake window", "weather", "health", "health log"
+};
+
+static struct Task tasks[TASK_COUNT];
+static AppTimer *wakeup_timer;
+static uint16_t batches;
+static uint16_t timer_batches;
+static uint16_t overruns;
+static uint16_t deferred_runs;
+static uint16_t slowest_batch; // ms
+
+static uint32_t now_ms() {
+    time_t seconds;
+    uint16_t millis;
+    time_ms(&seconds, &millis);
+    return (uint32_t)seconds * 1000 + millis;
+}
+
+// the first time from then on that is phase past a multiple of period
+static time_t next_aligned(time_t now, uint32_t period, uint32_t phase) {
+    struct tm *local = localtime(&now);
+    int32_t seconds = local->tm_hour * SECONDS_PER_HOUR + local->tm_min * SECONDS_PER_MINUTE + local->tm_sec;
+    int32_t past = ((seconds - (int32_t)phase) % (int32_t)period + period) % period;
+    return past == 0 ? now : now + period - past;
+}
+
+static void set_due(struct Task *task, time_t now) {
+    if (task->period == 0) {
+        task->due = 0;
+    } else if (task->timing == TIMING_ALIGNED) {
+        task->due = next_aligned(now, task->period, task->phase);
+    } else {
+        task->due = task->last_run + task->period;
+    }
+}
+
+static void run_batch(bool from_timer);
+
+static void wakeup_callback(void *context) {
+    wakeup_timer = NULL;
+    run_batch(true);
+}
+
+// the timer is only needed when a task can't wait for the next minute tick
+static void arm_wakeup(time_t now) {
+    time_t next_tick = now - now % SECONDS_PER_MINUTE + SECONDS_PER_MINUTE;
+    time_t deadline = next_tick;
+    for (int i = 0; i < TASK_COUNT; ++i) {
+        if (tasks[i].due && tasks[i].due + tasks[i].jitter < deadline) {
+            deadline = tasks[i].due + tasks[i].jitter;
+        }
+    }
+    if (deadline >= next_tick) {
+        if (wakeup_timer) {
+            app_timer_cancel(wakeup_timer);
+            wakeup_timer = NULL;
+        }
+        return;
+    }
+    uint32_t timeout = deadline > now ? (deadline - now) * 1000 : 0;
+    if (!wakeup_timer || !app_timer_reschedule(wakeup_timer, timeout)) {
+        wakeup_timer = app_timer_register(timeout, wakeup_callback, NULL);
+    }
+}
+
+static void run_batch(bool from_timer) {
+    time_t now = time(NULL);
+    uint32_t batch_start = now_ms();
+    bool over_budget = false;
+    bool ran = false;
+    batches++;
+    if (from_timer) {
+        timer_batches++;
+    }
+    // in task order, a task may reschedule the ones after it
+    for (int i = 0; i < TASK_COUNT; ++i) {
+        struct Task *task = &tasks[i];
+        if (!task->due || task->due > now) {
+            continue;
+        }
+        // the first one always runs, so every slice makes progress
+        if (over_budget || (ran && now_ms() - batch_start >= BATCH_BUDGET_MS)) {
+            // still due, arm_wakeup gives it the next slice
+            over_budget = true;
+            if (deferred_runs < UINT16_MAX) {
+                deferred_runs++;
+            }
+            continue;
+        }
+        ran = true;
+        task->last_run = now;
+        if (task->timing == TIMING_ONCE) {
+            task->due = 0;
+        } else {
+            set_due(task, now + 1);
+        }
+        uint32_t start = now_ms();
+        task->callback(task->context);
+        task->duration = now_ms() - start;
+        if (task->runs < UINT16_MAX) {
+            task->runs++;
+        }
+    }
+    uint32_t elapsed = now_ms() - batch_start;
+    if (elapsed > slowest_batch) {
+        slowest_batch = elapsed > UINT16_MAX ? UINT16_MAX : elapsed;
+    }
+    if (over_budget && overruns < UINT16_MAX) {
+        overruns++;
+    }
+    arm_wakeup(now);
+}
+
+static void set_task(int task, TaskCallback callback, void *context, uint8_t timing, uint32_t period, uint16_t jitter) {
+    tasks[task].callback = callback;
+    tasks[task].context = context;
+    tasks[task].timing = timing;
+    tasks[task].period = period;
+    tasks[task].jitter = jitter;
+}
+
+void schedule_task(int task, TaskCallback callback, void *context, uint32_t period, uint32_t phase, uint16_t jitter) {
+    time_t now = time(NULL);
+    set_task(task, callback, context, TIMING_ALIGNED, period, jitter);
+    tasks[task].phase = phase;
+    // from the next tick, none is due while the face loads
+    set_due(&tasks[task], now + 1);
+    arm_wakeup(now);
+}
+
+void schedule_task_after(int task, TaskCallback callback, void *context, time_t last_run, uint32_t period, uint16_t jitter) {
+    time_t now = time(NULL);
+    set_task(task, callback, context, TIMING_RELATIVE, period, jitter);
+    tasks[task].last_run = last_run;
+    set_due(&tasks[task], now);
+    if (tasks[task].due && tasks[task].due <= now) {
+        // already late, runs with the first tick
+        tasks[task].due = now - now % SECONDS_PER_MINUTE + SECONDS_PER_MINUTE;
+    }
+    arm_wakeup(now);
+}
+
+void schedule_task_at(int task, TaskCallback callback, void *context, time_t due, uint16_t jitter) {
+    set_task(task, callback, context, TIMING_ONCE, 0, jitter);
+    tasks[task].due = due;
+    arm_wakeup(time(NULL));
+}
+
+void set_task_period(int task, uint32_t period) {
+    if (tasks[task].period == period || tasks[task].timing == TIMING_ONCE) {
+        return;
+    }
+    time_t now = time(NULL);
+    tasks[task].period = period;
+    set_due(&tasks[task], now);
+    arm_wakeup(now);
+}
+
+void cancel_task(int task) {
+    tasks[task].due = 0;
+    tasks[task].period = 0;
+}
+
+void run_scheduled_tasks() {
+    run_batch(false);
+}
+
+uint16_t get_task_runs(int task) {
+    return tasks[task].runs;
+}
+
+uint16_t get_task_duration(int task) {
+    return tasks[task].duration;
+}
+
+uint16_t get_batch_overruns() {
+    return overruns;
+}
+
+uint16_t get_deferred_runs() {
+    return deferred_runs;
+}
+
+void log_scheduler_report() {
+    APP_LOG(APP_LOG_LEVEL_INFO, "Scheduler: %d batches, %d from the timer", batches, timer_batches);
+    APP_LOG(APP_LOG_LEVEL_INFO, "%d over budget, %d runs deferred, slowest %d ms", overruns, deferred_runs, slowest_batch);
+    for (int i = 0; i < TASK_COUNT; ++i) {
+        APP_LOG(APP_LOG_LEVEL_INFO, "%s: %d runs, last %d ms", task_names[i], tasks[i].runs, tasks[i].duration);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef __TIMEBOXED_SCHEDULER_
+#define __TIMEBOXED_SCHEDULER_
+
+#include <pebble.h>
+
+// the periodic work, run in this order when several are due together
+#define TASK_SLEEP_STATUS 0
+#define TASK_POWER 1
+#define TASK_UPDATE_CHECK 2
+#define TASK_SLEEP_DATA 3
+#define TASK_WAKE_WINDOW 4
+#define TASK_WEATHER 5
+#define TASK_HEALTH 6
+#define TASK_HEALTH_LOG 7
+#define TASK_COUNT 8
+
+typedef void (*TaskCallback)(void *context);
+
+// every period seconds, when the local time of day is phase past a multiple of it
+void schedule_task(int task, TaskCallback callback, void *context, uint32_t period, uint32_t phase, uint16_t jitter);
+// period seconds after its last run, starting as if that was at last_run
+void schedule_task_after(int task, TaskCallback callback, void *context, time_t last_run, uint32_t period, uint16_t jitter);
+// once, at due
+void schedule_task_at(int task, TaskCallback callback, void *context, time_t due, uint16_t jitter);
+// keeps the alignment or the last run, 0 pauses the task
+void set_task_period(int task, uint32_t period);
+void cancel_task(int task);
+
+void run_scheduled_tasks();
+
+uint16_t get_task_runs(int task);
+uint16_t get_task_duration(int task);
+uint16_t get_batch_overruns();
+uint16_t get_deferred_runs();
+void log_scheduler_report();
+
+#endif
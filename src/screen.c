@@ -7,26 +7,145 @@
 #include "time.h"
 #include "configs.h"
 #include "keys.h"
+#include "profiler.h"
+#include "power.h"
+#include "energy.h"
 
-void load_screen(bool from_configs, Window *watchface) {
-    if (from_configs) {
-        unload_face_fonts();
-    }
-    load_face_fonts();
-    set_face_fonts();
+// At launch only the time and date are loaded before the first frame, or the
+// snapshot of the last screen with the live time over it. The other stages
+// follow from timers, each one after the frame of the previous has had a
+// chance to draw. A marker layer on top of the text layers notes when the
+// first and the fully populated frames are drawn.
+#define STARTUP_FACE 1
+#define STARTUP_HEALTH 2
+#define STARTUP_WEATHER 3
+#define STARTUP_DONE 4
+#define STARTUP_STAGE_MS 10
+
+static Layer *startup_marker;
+static uint8_t startup_stage;
+static uint32_t startup_began;
+static bool first_frame_drawn;
+static bool snapshot_painted;
+
+static uint32_t startup_clock() {
+    time_t seconds;
+    uint16_t millis;
+    time_ms(&seconds, &millis);
+    return (uint32_t)seconds * 1000 + millis;
+}
+
+static void load_time_stage(Window *watchface) {
+    load_time_fonts();
+    set_time_fonts();
     load_locale();
+    invalidate_time_fields();
     update_time();
-    set_colors(watchface);
-    toggle_health(from_configs);
-    toggle_weather(from_configs);
+    set_time_colors(watchface);
+}
+
+static void load_face_stage() {
+    load_secondary_fonts();
+    set_secondary_fonts();
+    set_secondary_colors();
+}
+
+static void load_status_stage() {
     battery_handler(battery_state_service_peek());
     bt_handler(connection_service_peek_pebble_app_connection());
 }
 
-void redraw_screen(Window *watchface) {
-    destroy_text_layers();
-    create_text_layers(watchface);
-    load_screen(true, watchface);
+void load_screen(bool from_configs, Window *watchface) {
+    uint32_t start = profile_begin();
+    load_time_stage(watchface);
+    load_face_stage();
+    toggle_health(from_configs);
+    toggle_weather(from_configs);
+    load_status_stage();
+    profile_end(PROFILE_LOAD_SCREEN, start);
+}
+
+static void remove_startup_marker(void *context) {
+    layer_remove_from_parent(startup_marker);
+    layer_destroy(startup_marker);
+    startup_marker = NULL;
+}
+
+static void startup_marker_proc(Layer *layer, GContext *ctx) {
+    if (!first_frame_drawn) {
+        first_frame_drawn = true;
+        APP_LOG(APP_LOG_LEVEL_INFO, "Startup: first frame after %d ms", (int)(startup_clock() - startup_began));
+    } else if (startup_stage == STARTUP_DONE) {
+        APP_LOG(APP_LOG_LEVEL_INFO, "Startup: populated after %d ms", (int)(startup_clock() - startup_began));
+        // not from inside its own update
+        app_timer_register(0, remove_startup_marker, NULL);
+        startup_stage = 0;
+    }
+}
+
+static void startup_stage_callback(void *context) {
+    uint32_t start = profile_begin();
+    switch (startup_stage) {
+        case STARTUP_FACE:
+            if (snapshot_painted) {
+                set_secondary_colors();
+            } else {
+                load_face_stage();
+                set_secondary_layers_hidden(false);
+            }
+            break;
+        case STARTUP_HEALTH:
+            toggle_health(false);
+            break;
+        case STARTUP_WEATHER:
+            toggle_weather(false);
+            load_status_stage();
+            break;
+    }
+    profile_end(PROFILE_LOAD_SCREEN, start);
+    startup_stage++;
+    if (startup_stage < STARTUP_DONE) {
+        app_timer_register(STARTUP_STAGE_MS, startup_stage_callback, NULL);
+    } else {
+        layer_mark_dirty(startup_marker);
+    }
+}
+
+void start_screen(Window *watchface) {
+    startup_began = startup_clock();
+
+    Layer *window_layer = window_get_root_layer(watchface);
+    startup_marker = layer_create(layer_get_bounds(window_layer));
+    layer_set_update_proc(startup_marker, startup_marker_proc);
+    layer_add_child(window_layer, startup_marker);
+
+    uint32_t start = profile_begin();
+    snapshot_painted = paint_snapshot(watchface);
+    if (snapshot_painted) {
+        load_secondary_fonts();
+        set_secondary_fonts();
+    } else {
+        set_secondary_layers_hidden(true);
+    }
+    load_time_stage(watchface);
+    profile_end(PROFILE_LOAD_SCREEN, start);
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Startup: %s", snapshot_painted ? "painted the snapshot" : "no snapshot");
+
+    startup_stage = STARTUP_FACE;
+    app_timer_register(STARTUP_STAGE_MS, startup_stage_callback, NULL);
+}
+
+// Falling asleep or waking up only moves the module layers: the fonts,
+// colors and texts of the modules of both slot sets are loaded already.
+void switch_sleep_layout() {
+    relayout_text_layers();
+}
+
+void unobstructed_change_handler(AnimationProgress progress, void *context) {
+    #if PBL_API_EXISTS(layer_get_unobstructed_bounds)
+    Layer *window_layer = window_get_root_layer((Window *)context);
+    reflow_text_layers(layer_get_unobstructed_bounds(window_layer).size.h);
+    #endif
 }
 
 void bt_handler(bool connected) {
@@ -35,6 +154,7 @@ void bt_handler(bool connected) {
     } else {
         if (is_bluetooth_vibrate_enabled() && !is_user_sleeping()) {
             vibes_long_pulse();
+            energy_count(ENERGY_VIBRATION, 500);
         }
         set_bluetooth_color();
         set_bluetooth_layer_text("a");
@@ -51,6 +171,7 @@ void battery_handler(BatteryChargeState charge_state) {
     }
     set_battery_color(charge_state.charge_percent);
     set_battery_layer_text(s_battery_buffer);
+    update_power_profile(charge_state, is_user_sleeping());
 }
 
 void check_for_updates() {
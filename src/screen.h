@@ -3,8 +3,10 @@
 
 #include <pebble.h>
 
+void start_screen(Window *watchface);
 void load_screen(bool from_configs, Window *watchface);
-void redraw_screen(Window *watchface);
+void switch_sleep_layout();
+void unobstructed_change_handler(AnimationProgress progress, void *context);
 void bt_handler(bool connected);
 void battery_handler(BatteryChargeState battery_state);
 void update_time();
@@ -0,0 +1,246 @@
+#include <pebble.h>
+#include "keys.h"
+#include "storage.h"
+#include "energy.h"
+
+// Writes are held here and flushed together, after STORAGE_FLUSH_MS or on
+// unload. Values equal to what is already in flash are never written. Data
+// blobs are rare and written through, after the same comparison.
+#define STORAGE_PENDING_INTS 16
+#define STORAGE_PENDING_STRINGS 5
+#define STORAGE_STRING_LENGTH 16
+#define STORAGE_FLUSH_MS (60 * 1000)
+#define STORAGE_COMPARE_LENGTH 64
+
+struct PendingInt {
+    uint32_t key;
+    int32_t value;
+    bool used;
+};
+
+struct PendingString {
+    uint32_t key;
+    char value[STORAGE_STRING_LENGTH];
+    bool used;
+};
+
+static struct PendingInt pending_ints[STORAGE_PENDING_INTS];
+static struct PendingString pending_strings[STORAGE_PENDING_STRINGS];
+static AppTimer *flush_timer;
+
+static uint16_t key_writes[KEY_COUNT];
+static uint16_t total_writes;
+static uint16_t skipped_writes;
+static uint16_t coalesced_writes;
+
+static struct PendingInt *find_pending_int(const uint32_t key) {
+    for (int i = 0; i < STORAGE_PENDING_INTS; ++i) {
+        if (pending_ints[i].used && pending_ints[i].key == key) {
+            return &pending_ints[i];
+        }
+    }
+    return NULL;
+}
+
+static struct PendingString *find_pending_string(const uint32_t key) {
+    for (int i = 0; i < STORAGE_PENDING_STRINGS; ++i) {
+        if (pending_strings[i].used && pending_strings[i].key == key) {
+            return &pending_strings[i];
+        }
+    }
+    return NULL;
+}
+
+static bool stored_int_equals(const uint32_t key, const int32_t value) {
+    return persist_exists(key) && persist_get_size(key) == sizeof(int32_t) && persist_read_int(key) == value;
+}
+
+static bool stored_string_equals(const uint32_t key, const char *value) {
+    char stored[STORAGE_STRING_LENGTH];
+    int length = strlen(value) + 1;
+    if (!persist_exists(key) || persist_get_size(key) != length) {
+        return false;
+    }
+    persist_read_string(key, stored, sizeof(stored));
+    return strcmp(stored, value) == 0;
+}
+
+static bool stored_data_equals(const uint32_t key, const void *data, const size_t size) {
+    uint8_t stored[STORAGE_COMPARE_LENGTH];
+    if (size > sizeof(stored) || !persist_exists(key) || persist_get_size(key) != (int)size) {
+        return false;
+    }
+    persist_read_data(key, stored, size);
+    return memcmp(stored, data, size) == 0;
+}
+
+static void count_write(const uint32_t key, const size_t size) {
+    total_writes++;
+    energy_count(ENERGY_FLASH_WRITE, size);
+    if (key < KEY_COUNT) {
+        key_writes[key]++;
+    }
+}
+
+static void flush_callback(void *context) {
+    flush_timer = NULL;
+    storage_flush();
+}
+
+static void schedule_flush() {
+    if (!flush_timer) {
+        flush_timer = app_timer_register(STORAGE_FLUSH_MS, flush_callback, NULL);
+    }
+}
+
+bool storage_exists(const uint32_t key) {
+    return find_pending_int(key) || find_pending_string(key) || persist_exists(key);
+}
+
+int32_t storage_read_int(const uint32_t key) {
+    struct PendingInt *entry = find_pending_int(key);
+    return entry ? entry->value : persist_read_int(key);
+}
+
+int storage_read_string(const uint32_t key, char *buffer, const size_t buffer_size) {
+    struct PendingString *entry = find_pending_string(key);
+    if (!entry) {
+        return persist_read_string(key, buffer, buffer_size);
+    }
+    strncpy(buffer, entry->value, buffer_size);
+    buffer[buffer_size - 1] = '\0';
+    return strlen(buffer) + 1;
+}
+
+int storage_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+    return persist_read_data(key, buffer, buffer_size);
+}
+
+void storage_write_data(const uint32_t key, const void *data, const size_t size) {
+    if (stored_data_equals(key, data, size)) {
+        skipped_writes++;
+        return;
+    }
+    persist_write_data(key, data, size);
+    count_write(key, size);
+}
+
+void storage_delete(const uint32_t key) {
+    struct PendingInt *int_entry = find_pending_int(key);
+    struct PendingString *string_entry = find_pending_string(key);
+    if (int_entry) {
+        int_entry->used = false;
+    }
+    if (string_entry) {
+        string_entry->used = false;
+    }
+    if (persist_exists(key)) {
+        persist_delete(key);
+        count_write(key, 0);
+    }
+}
+
+void storage_write_int(const uint32_t key, const int32_t value) {
+    struct PendingInt *entry = find_pending_int(key);
+    if (entry) {
+        entry->value = value;
+        coalesced_writes++;
+        return;
+    }
+    if (stored_int_equals(key, value)) {
+        skipped_writes++;
+        return;
+    }
+    for (int i = 0; i < STORAGE_PENDING_INTS; ++i) {
+        if (!pending_ints[i].used) {
+            pending_ints[i].key = key;
+            pending_ints[i].value = value;
+            pending_ints[i].used = true;
+            schedule_flush();
+            return;
+        }
+    }
+    // no room left, make some and write this one through
+    storage_flush();
+    persist_write_int(key, value);
+    count_write(key, sizeof(value));
+}
+
+void storage_write_string(const uint32_t key, const char *value) {
+    size_t length = strlen(value);
+    struct PendingString *entry = find_pending_string(key);
+    if (entry && length < STORAGE_STRING_LENGTH) {
+        strcpy(entry->value, value);
+        coalesced_writes++;
+        return;
+    }
+    if (entry) {
+        entry->used = false;
+    }
+    if (length >= STORAGE_STRING_LENGTH) {
+        // too long to hold, written through (only the location override)
+        persist_write_string(key, value);
+        count_write(key, length + 1);
+        return;
+    }
+    if (stored_string_equals(key, value)) {
+        skipped_writes++;
+        return;
+    }
+    for (int i = 0; i < STORAGE_PENDING_STRINGS; ++i) {
+        if (!pending_strings[i].used) {
+            pending_strings[i].key = key;
+            strcpy(pending_strings[i].value, value);
+            pending_strings[i].used = true;
+            schedule_flush();
+            return;
+        }
+    }
+    storage_flush();
+    persist_write_string(key, value);
+    count_write(key, length + 1);
+}
+
+void storage_flush() {
+    if (flush_timer) {
+        app_timer_cancel(flush_timer);
+        flush_timer = NULL;
+    }
+    for (int i = 0; i < STORAGE_PENDING_INTS; ++i) {
+        struct PendingInt *entry = &pending_ints[i];
+        if (!entry->used) {
+            continue;
+        }
+        entry->used = false;
+        // coalescing may have brought it back to the stored value
+        if (stored_int_equals(entry->key, entry->value)) {
+            skipped_writes++;
+            continue;
+        }
+        persist_write_int(entry->key, entry->value);
+        count_write(entry->key, sizeof(entry->value));
+    }
+    for (int i = 0; i < STORAGE_PENDING_STRINGS; ++i) {
+        struct PendingString *entry = &pending_strings[i];
+        if (!entry->used) {
+            continue;
+        }
+        entry->used = false;
+        if (stored_string_equals(entry->key, entry->value)) {
+            skipped_writes++;
+            continue;
+        }
+        persist_write_string(entry->key, entry->value);
+        count_write(entry->key, strlen(entry->value) + 1);
+    }
+}
+
+void log_storage_report() {
+    APP_LOG(APP_LOG_LEVEL_INFO, "Storage: %d writes, %d skipped, %d coalesced",
+            total_writes, skipped_writes, coalesced_writes);
+    for (int key = 0; key < KEY_COUNT; ++key) {
+        if (key_writes[key] > 0) {
+            APP_LOG(APP_LOG_LEVEL_INFO, "key %d: %d writes", key, key_writes[key]);
+        }
+    }
+}
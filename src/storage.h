@@ -0,0 +1,19 @@
+#ifndef __TIMEBOXED_STORAGE_
+#define __TIMEBOXED_STORAGE_
+
+#include <pebble.h>
+
+bool storage_exists(const uint32_t key);
+int32_t storage_read_int(const uint32_t key);
+int storage_read_string(const uint32_t key, char *buffer, const size_t buffer_size);
+int storage_read_data(const uint32_t key, void *buffer, const size_t buffer_size);
+
+void storage_write_int(const uint32_t key, const int32_t value);
+void storage_write_string(const uint32_t key, const char *value);
+void storage_write_data(const uint32_t key, const void *data, const size_t size);
+void storage_delete(const uint32_t key);
+
+void storage_flush();
+void log_storage_report();
+
+#endif
@@ -3,6 +3,13 @@
 #include "keys.h"
 #include "configs.h"
 #include "positions.h"
+#include "fonts.h"
+#include "memory.h"
+#include "profiler.h"
+#include "storage.h"
+#include "health.h"
+#include "modules.h"
+#include "energy.h"
 
 static TextLayer *hours;
 static TextLayer *date;
@@ -28,6 +35,22 @@ static TextLayer *update;
 static TextLayer *direction;
 static TextLayer *speed;
 static TextLayer *wind_unit;
+static TextLayer *world_clocks[WORLD_CLOCKS - 1]; // the ones after the alt time
+
+#if defined(TIMEBOXED_INSTRUMENT)
+// empty layers drawn before and after the text layers to time each frame
+static Layer *render_start;
+static Layer *render_end;
+static uint32_t render_started_at;
+
+static void render_start_proc(Layer *layer, GContext *ctx) {
+    render_started_at = profile_begin();
+}
+
+static void render_end_proc(Layer *layer, GContext *ctx) {
+    profile_end(PROFILE_RENDER, render_started_at);
+}
+#endif
 
 static GFont time_font;
 static GFont medium_font;
@@ -35,6 +58,12 @@ static GFont base_font;
 static GFont weather_font;
 static GFont custom_font;
 
+static uint32_t time_font_id;
+static uint32_t medium_font_id;
+static uint32_t base_font_id;
+static uint32_t weather_font_id;
+static uint32_t custom_font_id;
+
 static GColor base_color;
 static GColor battery_color;
 static GColor battery_low_color;
@@ -57,7 +86,7 @@ static char date_text[13];
 static char bluetooth_text[4];
 static char update_text[4];
 static char battery_text[8];
-static char alt_time_text[22];
+static char alt_time_text[WORLD_CLOCK_TEXT_LEN];
 
 static char temp_cur_text[8];
 static char temp_max_text[8];
@@ -68,30 +97,340 @@ static char weather_text[4];
 static char direction_text[4];
 static char speed_text[8];
 static char wind_unit_text[2];
+static char world_clock_text[WORLD_CLOCKS - 1][WORLD_CLOCK_TEXT_LEN];
 
 #if defined(PBL_HEALTH)
-static char steps_text[16];
-static char cal_text[16];
-static char dist_text[16];
-static char sleep_text[16];
-static char deep_text[16];
+static char steps_text[HEALTH_TEXT_LEN];
+static char cal_text[HEALTH_TEXT_LEN];
+static char dist_text[HEALTH_TEXT_LEN];
+static char sleep_text[HEALTH_TEXT_LEN];
+static char deep_text[HEALTH_TEXT_LEN];
 #endif
 
 static uint8_t loaded_font;
 static bool enable_advanced;
 
+// Every text layer with its frame in the full screen layout. When Quick View
+// covers part of the screen the same layers are moved or hidden, never rebuilt.
+#if defined(PBL_HEALTH)
+#define TEXT_LAYERS (15 + WORLD_CLOCKS - 1 + 5)
+#else
+#define TEXT_LAYERS (15 + WORLD_CLOCKS - 1)
+#endif
+
+static TextLayer *text_layers[TEXT_LAYERS];
+static GRect full_frames[TEXT_LAYERS];
+static bool unplaced_layers[TEXT_LAYERS]; // of a module in no slot of the current mode
+static bool secondary_hidden;
+static char *text_buffers[TEXT_LAYERS];
+static uint8_t text_sizes[TEXT_LAYERS];
+static GColor text_colors[TEXT_LAYERS];
+static uint8_t text_layer_count;
+static int16_t full_height;
+static int16_t reflow_height;
+// the rows from peek_top move up in a peek, the ones from peek_bottom hide
+static int16_t peek_top;
+static int16_t peek_bottom;
+static int16_t peek_offset;
+
+static GColor background_color;
+static uint8_t layout_id;
+
+// everything that moves the layers, a snapshot only fits the same layout
+static uint8_t get_layout_id() {
+    return layout_id | should_show_sleep_data() << 6;
+}
+
+static void add_text_layer(Layer *window_layer, TextLayer *text_layer, char *buffer, uint8_t size) {
+    Layer *layer = text_layer_get_layer(text_layer);
+    layer_add_child(window_layer, layer);
+    text_layers[text_layer_count] = text_layer;
+    full_frames[text_layer_count] = layer_get_frame(layer);
+    unplaced_layers[text_layer_count] = false;
+    text_colors[text_layer_count] = GColorBlack; // the SDK's default
+    text_buffers[text_layer_count] = buffer;
+    text_sizes[text_layer_count] = size;
+    text_layer_count++;
+}
+
+// Every change below redraws the whole layer, counted with its area for the
+// energy model. A hidden layer isn't drawn, so it costs nothing.
+static void count_invalidation(Layer *layer) {
+    if (layer_get_hidden(layer)) {
+        return;
+    }
+    GRect frame = layer_get_frame(layer);
+    energy_count(ENERGY_INVALIDATION, frame.size.w * frame.size.h);
+}
+
+static void show_text(TextLayer *text_layer, const char *text) {
+    count_invalidation(text_layer_get_layer(text_layer));
+    text_layer_set_text(text_layer, text);
+}
+
+static void set_font(TextLayer *text_layer, GFont font) {
+    count_invalidation(text_layer_get_layer(text_layer));
+    text_layer_set_font(text_layer, font);
+}
+
+static void set_alignment(TextLayer *text_layer, GTextAlignment alignment) {
+    count_invalidation(text_layer_get_layer(text_layer));
+    text_layer_set_text_alignment(text_layer, alignment);
+}
+
+// counted where it is visible, before hiding or after showing
+static void set_layer_hidden(Layer *layer, bool hidden) {
+    if (layer_get_hidden(layer) == hidden) {
+        return;
+    }
+    count_invalidation(layer);
+    layer_set_hidden(layer, hidden);
+    count_invalidation(layer);
+}
+
+// both the area left and the one taken are redrawn
+static void set_layer_frame(Layer *layer, GRect frame) {
+    count_invalidation(layer);
+    layer_set_frame(layer, frame);
+    count_invalidation(layer);
+}
+
+// colors are kept for the snapshot, the SDK has no getter, and an unchanged
+// one isn't set again
+static void set_text_color(TextLayer *text_layer, GColor color) {
+    for (int i = 0; i < text_layer_count; ++i) {
+        if (text_layers[i] == text_layer) {
+            if (gcolor_equal(text_colors[i], color)) {
+                return;
+            }
+            text_colors[i] = color;
+            break;
+        }
+    }
+    count_invalidation(text_layer_get_layer(text_layer));
+    text_layer_set_text_color(text_layer, color);
+}
+
+// A layer is hidden while the fonts load, when its module has no slot, or
+// when a peek covers its row. The time and date show from the first frame.
+static void update_layer_hidden(int i) {
+    bool hidden = unplaced_layers[i] ||
+        (reflow_height < full_height && full_frames[i].origin.y >= peek_bottom);
+    if (text_layers[i] != hours && text_layers[i] != date) {
+        hidden = hidden || secondary_hidden;
+    }
+    set_layer_hidden(text_layer_get_layer(text_layers[i]), hidden);
+}
+
+// the rows of the time and date follow the obstruction up until they are
+// peek_offset higher, the rows above them stay
+static GRect get_reflow_frame(GRect frame) {
+    if (frame.origin.y >= peek_top && frame.origin.y < peek_bottom) {
+        int16_t covered = full_height - reflow_height;
+        frame.origin.y -= covered < peek_offset ? covered : peek_offset;
+    }
+    return frame;
+}
+
+void reflow_text_layers(int16_t height) {
+    if (height == reflow_height) {
+        return;
+    }
+    reflow_height = height;
+    for (int i = 0; i < text_layer_count; ++i) {
+        Layer *layer = text_layer_get_layer(text_layers[i]);
+        update_layer_hidden(i);
+        GRect frame = get_reflow_frame(full_frames[i]);
+        if (layer_get_frame(layer).origin.y != frame.origin.y) {
+            set_layer_frame(layer, frame);
+        }
+    }
+}
+
+// the layout the module layers are placed in, set by create_text_layers
+static uint8_t layout_font;
+static uint8_t layout_mode;
+static int16_t layout_width;
+static int16_t layout_slot_width;
+static GTextAlignment layout_align;
+
+#define SLOT_WIDTH -1 // the width of a slot, the screen in simple mode
+#define FULL_WIDTH 0
+#define SLOT_ALIGNMENT -1 // towards the edge of the slot, the text alignment in simple mode
+
+// The text layers of every module, in the order they are added. A module
+// not in any slot keeps its layers, placed where get_pos_for_item puts
+// slot -1.
+struct ModuleLayer {
+    uint8_t module;
+    uint8_t item;
+    int8_t x_offset;
+    int8_t y_offset;
+    int8_t width; // in pixels, or SLOT_WIDTH or FULL_WIDTH
+    int8_t alignment; // a GTextAlignment or SLOT_ALIGNMENT
+    TextLayer **layer;
+    char *text;
+    uint8_t size;
+};
+
+static const struct ModuleLayer module_layers[] = {
+    { MODULE_WEATHER, WEATHER_ITEM, 0, 0, PBL_IF_ROUND_ELSE(FULL_WIDTH, 38), GTextAlignmentCenter,
+      &weather, weather_text, sizeof(weather_text) },
+    { MODULE_WEATHER, TEMP_ITEM, 0, 0, FULL_WIDTH, PBL_IF_ROUND_ELSE(GTextAlignmentCenter, GTextAlignmentLeft),
+      &temp_cur, temp_cur_text, sizeof(temp_cur_text) },
+    { MODULE_FORECAST, TEMPMIN_ITEM, -10, 1, FULL_WIDTH, GTextAlignmentLeft,
+      &min_icon, min_icon_text, sizeof(min_icon_text) },
+    { MODULE_FORECAST, TEMPMAX_ITEM, -10, 1, FULL_WIDTH, GTextAlignmentLeft,
+      &max_icon, max_icon_text, sizeof(max_icon_text) },
+    { MODULE_FORECAST, TEMPMIN_ITEM, 0, 0, FULL_WIDTH, GTextAlignmentLeft,
+      &temp_min, temp_min_text, sizeof(temp_min_text) },
+    { MODULE_FORECAST, TEMPMAX_ITEM, 0, 0, FULL_WIDTH, GTextAlignmentLeft,
+      &temp_max, temp_max_text, sizeof(temp_max_text) },
+    { MODULE_WIND, SPEED_ITEM, 0, 0, 42, GTextAlignmentRight,
+      &speed, speed_text, sizeof(speed_text) },
+    { MODULE_WIND, DIRECTION_ITEM, 0, 0, FULL_WIDTH, GTextAlignmentLeft,
+      &direction, direction_text, sizeof(direction_text) },
+    { MODULE_WIND, WIND_UNIT_ITEM, 0, 0, FULL_WIDTH, GTextAlignmentLeft,
+      &wind_unit, wind_unit_text, sizeof(wind_unit_text) },
+    { MODULE_TIMEZONE2, TIMEZONE_ITEM, 0, 0, SLOT_WIDTH, SLOT_ALIGNMENT,
+      &world_clocks[0], world_clock_text[0], sizeof(world_clock_text[0]) },
+    { MODULE_TIMEZONE3, TIMEZONE_ITEM, 0, 0, SLOT_WIDTH, SLOT_ALIGNMENT,
+      &world_clocks[1], world_clock_text[1], sizeof(world_clock_text[1]) },
+    #if defined(PBL_HEALTH)
+    { MODULE_STEPS, STEPS_ITEM, 0, 0, SLOT_WIDTH, SLOT_ALIGNMENT, &steps, steps_text, sizeof(steps_text) },
+    { MODULE_DIST, DIST_ITEM, 0, 0, SLOT_WIDTH, SLOT_ALIGNMENT, &dist, dist_text, sizeof(dist_text) },
+    { MODULE_CAL, CAL_ITEM, 0, 0, SLOT_WIDTH, SLOT_ALIGNMENT, &cal, cal_text, sizeof(cal_text) },
+    { MODULE_SLEEP, SLEEP_ITEM, 0, 0, SLOT_WIDTH, SLOT_ALIGNMENT, &sleep, sleep_text, sizeof(sleep_text) },
+    { MODULE_DEEP, DEEP_ITEM, 0, 0, SLOT_WIDTH, SLOT_ALIGNMENT, &deep, deep_text, sizeof(deep_text) },
+    #endif
+};
+
+#define MODULE_LAYERS (sizeof(module_layers) / sizeof(module_layers[0]))
+
+// The frame and alignment of every module layer in the awake [0] and the
+// asleep [1] slots, computed with the layers. Falling asleep or waking up
+// only assigns them.
+static GRect module_frames[2][MODULE_LAYERS];
+static uint8_t module_alignments[2][MODULE_LAYERS];
+static bool module_placed[2][MODULE_LAYERS];
+static uint8_t module_layer_index[MODULE_LAYERS]; // in text_layers
+
+static GRect get_module_layer_frame(const struct ModuleLayer *spec, int slot) {
+    GPoint pos = get_pos_for_item(slot, spec->item, layout_mode, layout_font);
+    int16_t width = spec->width;
+    if (width == FULL_WIDTH) {
+        width = layout_width;
+    } else if (width == SLOT_WIDTH) {
+        width = PBL_IF_ROUND_ELSE(layout_width, layout_slot_width);
+    }
+    return GRect(pos.x + spec->x_offset, pos.y + spec->y_offset, width, 50);
+}
+
+static GTextAlignment get_module_layer_alignment(const struct ModuleLayer *spec, int slot) {
+    if (spec->alignment != SLOT_ALIGNMENT) {
+        return spec->alignment;
+    }
+    return PBL_IF_ROUND_ELSE(GTextAlignmentCenter,
+            layout_mode == MODE_SIMPLE ? layout_align : (slot % 2 == 0 ? GTextAlignmentLeft : GTextAlignmentRight));
+}
+
+// the create, layout, place and destroy hooks of every module with text
+// layers, placed by create_module_layers
+void create_module_text_layers(int module, Layer *window_layer) {
+    for (unsigned int i = 0; i < MODULE_LAYERS; ++i) {
+        const struct ModuleLayer *spec = &module_layers[i];
+        if (spec->module != module) {
+            continue;
+        }
+        TextLayer *text_layer = text_layer_create(GRectZero);
+        text_layer_set_background_color(text_layer, GColorClear);
+        module_layer_index[i] = text_layer_count;
+        add_text_layer(window_layer, text_layer, spec->text, spec->size);
+        *spec->layer = text_layer;
+    }
+}
+
+void layout_module_text_layers(int module, int awake_slot, int asleep_slot) {
+    const int slots[2] = { awake_slot, asleep_slot };
+    for (unsigned int i = 0; i < MODULE_LAYERS; ++i) {
+        const struct ModuleLayer *spec = &module_layers[i];
+        if (spec->module != module) {
+            continue;
+        }
+        for (int asleep = 0; asleep < 2; ++asleep) {
+            int slot = slots[asleep];
+            module_placed[asleep][i] = slot >= 0;
+            module_frames[asleep][i] = slot >= 0 ? get_module_layer_frame(spec, slot) : GRectZero;
+            module_alignments[asleep][i] = slot >= 0 ? get_module_layer_alignment(spec, slot) : GTextAlignmentLeft;
+        }
+    }
+}
+
+void place_module_text_layers(int module, bool asleep) {
+    for (unsigned int i = 0; i < MODULE_LAYERS; ++i) {
+        if (module_layers[i].module != module) {
+            continue;
+        }
+        int j = module_layer_index[i];
+        Layer *layer = text_layer_get_layer(text_layers[j]);
+        if (unplaced_layers[j] && module_placed[asleep][i]) {
+            // a world clock may have been kept in its buffer only
+            show_text(text_layers[j], text_buffers[j]);
+        }
+        unplaced_layers[j] = !module_placed[asleep][i];
+        GRect frame = module_frames[asleep][i];
+        bool moved = !unplaced_layers[j] && !grect_equal(&full_frames[j], &frame);
+        if (moved) {
+            full_frames[j] = frame;
+        }
+        update_layer_hidden(j);
+        if (!moved) {
+            continue;
+        }
+        set_layer_frame(layer, get_reflow_frame(frame));
+        set_alignment(text_layers[j], module_alignments[asleep][i]);
+    }
+}
+
+void destroy_module_text_layers(int module) {
+    for (unsigned int i = 0; i < MODULE_LAYERS; ++i) {
+        if (module_layers[i].module == module) {
+            text_layer_destroy(*module_layers[i].layer);
+        }
+    }
+}
+
+// after a switch between the awake and the asleep slots, the layers are
+// moved, not rebuilt
+void relayout_text_layers() {
+    place_modules();
+}
+
+// what the first layer of a module shows, the single copy of it
+const char *get_module_text(int module) {
+    for (unsigned int i = 0; i < MODULE_LAYERS; ++i) {
+        if (module_layers[i].module == module) {
+            return module_layers[i].text;
+        }
+    }
+    return "";
+}
+
 uint8_t get_loaded_font() {
     return loaded_font;
 }
 
 void create_text_layers(Window* window) {
+    memory_phase_begin(PHASE_CREATE_LAYERS);
+
     Layer *window_layer = window_get_root_layer(window);
     GRect bounds = layer_get_bounds(window_layer);
 
-    int selected_font = persist_exists(KEY_FONTTYPE) ? persist_read_int(KEY_FONTTYPE) : BLOCKO_FONT;
+    int selected_font = storage_exists(KEY_FONTTYPE) ? storage_read_int(KEY_FONTTYPE) : BLOCKO_FONT;
 
-    int alignment = PBL_IF_ROUND_ELSE(ALIGN_CENTER, persist_exists(KEY_TEXTALIGN) ? persist_read_int(KEY_TEXTALIGN) : ALIGN_RIGHT);
+    int alignment = PBL_IF_ROUND_ELSE(ALIGN_CENTER, storage_exists(KEY_TEXTALIGN) ? storage_read_int(KEY_TEXTALIGN) : ALIGN_RIGHT);
     int mode = is_simple_mode_enabled() ? MODE_SIMPLE : MODE_NORMAL;
+    layout_id = selected_font | alignment << 3 | mode << 5;
 
     GTextAlignment text_align = GTextAlignmentRight;
     switch (alignment) {
@@ -110,7 +449,11 @@ void create_text_layers(Window* window) {
     get_text_positions(selected_font, text_align, &text_positions);
 
     int width = bounds.size.w;
-    int slot_width = is_simple_mode_enabled() ? width : 68;
+    layout_font = selected_font;
+    layout_mode = mode;
+    layout_width = width;
+    layout_slot_width = is_simple_mode_enabled() ? width : 68;
+    layout_align = text_align;
 
     hours = text_layer_create(GRect(text_positions.hours.x, text_positions.hours.y, width, 100));
     text_layer_set_background_color(hours, GColorClear);
@@ -136,112 +479,38 @@ void create_text_layers(Window* window) {
     text_layer_set_background_color(update, GColorClear);
     text_layer_set_text_alignment(update, text_align == GTextAlignmentLeft ? GTextAlignmentRight : GTextAlignmentLeft);
 
-    int weather_slot = get_slot_for_module(MODULE_WEATHER);
-    GPoint weather_pos = get_pos_for_item(weather_slot, WEATHER_ITEM, mode, selected_font);
-    weather = text_layer_create(GRect(weather_pos.x, weather_pos.y, PBL_IF_ROUND_ELSE(width, 38), 50));
-    text_layer_set_background_color(weather, GColorClear);
-    text_layer_set_text_alignment(weather, GTextAlignmentCenter);
-
-    GPoint temp_pos = get_pos_for_item(weather_slot, TEMP_ITEM, mode, selected_font);
-    temp_cur = text_layer_create(GRect(temp_pos.x, temp_pos.y, width, 50));
-    text_layer_set_background_color(temp_cur, GColorClear);
-    text_layer_set_text_alignment(temp_cur, PBL_IF_ROUND_ELSE(GTextAlignmentCenter, GTextAlignmentLeft));
-
-    int forecast_slot = get_slot_for_module(MODULE_FORECAST);
-    GPoint min_pos = get_pos_for_item(forecast_slot, TEMPMIN_ITEM, mode, selected_font);
-    temp_min = text_layer_create(GRect(min_pos.x, min_pos.y, width, 50));
-    text_layer_set_background_color(temp_min, GColorClear);
-    text_layer_set_text_alignment(temp_min, GTextAlignmentLeft);
-
-    min_icon = text_layer_create(GRect(min_pos.x - 10, min_pos.y + 1, width, 50));
-    text_layer_set_background_color(min_icon, GColorClear);
-    text_layer_set_text_alignment(min_icon, GTextAlignmentLeft);
-
-    GPoint max_pos = get_pos_for_item(forecast_slot, TEMPMAX_ITEM, mode, selected_font);
-    temp_max = text_layer_create(GRect(max_pos.x, max_pos.y, width, 50));
-    text_layer_set_background_color(temp_max, GColorClear);
-    text_layer_set_text_alignment(temp_max, GTextAlignmentLeft);
-
-    max_icon = text_layer_create(GRect(max_pos.x - 10, max_pos.y + 1, width, 50));
-    text_layer_set_background_color(max_icon, GColorClear);
-    text_layer_set_text_alignment(max_icon, GTextAlignmentLeft);
-
-    int wind_slot = get_slot_for_module(MODULE_WIND);
-    GPoint speed_pos = get_pos_for_item(wind_slot, SPEED_ITEM, mode, selected_font);
-    speed = text_layer_create(GRect(speed_pos.x, speed_pos.y, 42, 50));
-    text_layer_set_background_color(speed, GColorClear);
-    text_layer_set_text_alignment(speed, GTextAlignmentRight);
-
-    GPoint direction_pos = get_pos_for_item(wind_slot, DIRECTION_ITEM, mode, selected_font);
-    direction = text_layer_create(GRect(direction_pos.x, direction_pos.y, width, 50));
-    text_layer_set_background_color(direction, GColorClear);
-    text_layer_set_text_alignment(direction, GTextAlignmentLeft);
-    
-    GPoint wind_unit_pos = get_pos_for_item(wind_slot, WIND_UNIT_ITEM, mode, selected_font);
-    wind_unit = text_layer_create(GRect(wind_unit_pos.x, wind_unit_pos.y, width, 50));
-    text_layer_set_background_color(wind_unit, GColorClear);
-    text_layer_set_text_alignment(wind_unit, GTextAlignmentLeft);
-
-    #if defined(PBL_HEALTH)
-    int steps_slot = get_slot_for_module(MODULE_STEPS);
-    GPoint steps_pos = get_pos_for_item(steps_slot, STEPS_ITEM, mode, selected_font);
-    steps = text_layer_create(GRect(steps_pos.x, steps_pos.y, PBL_IF_ROUND_ELSE(width, slot_width), 50));
-    text_layer_set_background_color(steps, GColorClear);
-    text_layer_set_text_alignment(steps, PBL_IF_ROUND_ELSE(
-                GTextAlignmentCenter, is_simple_mode_enabled() ? text_align : (steps_slot % 2 == 0 ? GTextAlignmentLeft : GTextAlignmentRight)));
-
-    int dist_slot = get_slot_for_module(MODULE_DIST);
-    GPoint dist_pos = get_pos_for_item(dist_slot, DIST_ITEM, mode, selected_font);
-    dist = text_layer_create(GRect(dist_pos.x, dist_pos.y, PBL_IF_ROUND_ELSE(width, slot_width), 50));
-    text_layer_set_background_color(dist, GColorClear);
-    text_layer_set_text_alignment(dist, PBL_IF_ROUND_ELSE(
-                GTextAlignmentCenter, is_simple_mode_enabled() ? text_align : (dist_slot % 2 == 0 ? GTextAlignmentLeft : GTextAlignmentRight)));
-
-    int cal_slot = get_slot_for_module(MODULE_CAL);
-    GPoint cal_pos = get_pos_for_item(cal_slot, CAL_ITEM, mode, selected_font);
-    cal = text_layer_create(GRect(cal_pos.x, cal_pos.y, PBL_IF_ROUND_ELSE(width, slot_width), 50));
-    text_layer_set_background_color(cal, GColorClear);
-    text_layer_set_text_alignment(cal, PBL_IF_ROUND_ELSE(
-                GTextAlignmentCenter, is_simple_mode_enabled() ? text_align : (cal_slot % 2 == 0 ? GTextAlignmentLeft : GTextAlignmentRight)));
-
-    int sleep_slot = get_slot_for_module(MODULE_SLEEP);
-    GPoint sleep_pos = get_pos_for_item(sleep_slot, SLEEP_ITEM, mode, selected_font);
-    sleep = text_layer_create(GRect(sleep_pos.x, sleep_pos.y, PBL_IF_ROUND_ELSE(width, slot_width), 50));
-    text_layer_set_background_color(sleep, GColorClear);
-    text_layer_set_text_alignment(sleep, PBL_IF_ROUND_ELSE(
-                GTextAlignmentCenter, is_simple_mode_enabled() ? text_align : (sleep_slot % 2 == 0 ? GTextAlignmentLeft : GTextAlignmentRight)));
-
-    int deep_slot = get_slot_for_module(MODULE_DEEP);
-    GPoint deep_pos = get_pos_for_item(deep_slot, DEEP_ITEM, mode, selected_font);
-    deep = text_layer_create(GRect(deep_pos.x, deep_pos.y, PBL_IF_ROUND_ELSE(width, slot_width), 50));
-    text_layer_set_background_color(deep, GColorClear);
-    text_layer_set_text_alignment(deep, PBL_IF_ROUND_ELSE(
-                GTextAlignmentCenter, is_simple_mode_enabled() ? text_align : (deep_slot % 2 == 0 ? GTextAlignmentLeft : GTextAlignmentRight)));
+    #if defined(TIMEBOXED_INSTRUMENT)
+    render_start = layer_create(bounds);
+    layer_set_update_proc(render_start, render_start_proc);
+    layer_add_child(window_layer, render_start);
     #endif
 
-    layer_add_child(window_layer, text_layer_get_layer(hours));
-    layer_add_child(window_layer, text_layer_get_layer(date));
-    layer_add_child(window_layer, text_layer_get_layer(alt_time));
-    layer_add_child(window_layer, text_layer_get_layer(battery));
-    layer_add_child(window_layer, text_layer_get_layer(bluetooth));
-    layer_add_child(window_layer, text_layer_get_layer(update));
-    layer_add_child(window_layer, text_layer_get_layer(weather));
-    layer_add_child(window_layer, text_layer_get_layer(min_icon));
-    layer_add_child(window_layer, text_layer_get_layer(max_icon));
-    layer_add_child(window_layer, text_layer_get_layer(temp_cur));
-    layer_add_child(window_layer, text_layer_get_layer(temp_min));
-    layer_add_child(window_layer, text_layer_get_layer(temp_max));
-    layer_add_child(window_layer, text_layer_get_layer(speed));
-    layer_add_child(window_layer, text_layer_get_layer(direction));
-    layer_add_child(window_layer, text_layer_get_layer(wind_unit));
+    text_layer_count = 0;
+    full_height = bounds.size.h;
+    reflow_height = bounds.size.h;
+    peek_top = text_positions.hours.y < text_positions.alt_time.y ? text_positions.hours.y : text_positions.alt_time.y;
+    peek_bottom = text_positions.battery.y;
+    peek_offset = get_peek_offset(selected_font);
+    add_text_layer(window_layer, hours, hour_text, sizeof(hour_text));
+    add_text_layer(window_layer, date, date_text, sizeof(date_text));
+    add_text_layer(window_layer, alt_time, alt_time_text, sizeof(alt_time_text));
+    add_text_layer(window_layer, battery, battery_text, sizeof(battery_text));
+    add_text_layer(window_layer, bluetooth, bluetooth_text, sizeof(bluetooth_text));
+    add_text_layer(window_layer, update, update_text, sizeof(update_text));
+    create_module_layers(window_layer);
+
+    #if defined(TIMEBOXED_INSTRUMENT)
+    render_end = layer_create(bounds);
+    layer_set_update_proc(render_end, render_end_proc);
+    layer_add_child(window_layer, render_end);
+    #endif
 
-    #if defined(PBL_HEALTH)
-    layer_add_child(window_layer, text_layer_get_layer(steps));
-    layer_add_child(window_layer, text_layer_get_layer(dist));
-    layer_add_child(window_layer, text_layer_get_layer(cal));
-    layer_add_child(window_layer, text_layer_get_layer(sleep));
-    layer_add_child(window_layer, text_layer_get_layer(deep));
+    #if PBL_API_EXISTS(layer_get_unobstructed_bounds)
+    // created while a peek is showing
+    reflow_text_layers(layer_get_unobstructed_bounds(window_layer).size.h);
     #endif
+
+    memory_phase_end(PHASE_CREATE_LAYERS);
 }
 
 void destroy_text_layers() {
@@ -251,282 +520,426 @@ void destroy_text_layers() {
     text_layer_destroy(battery);
     text_layer_destroy(bluetooth);
     text_layer_destroy(update);
-    text_layer_destroy(weather);
-    text_layer_destroy(min_icon);
-    text_layer_destroy(max_icon);
-    text_layer_destroy(temp_cur);
-    text_layer_destroy(temp_min);
-    text_layer_destroy(temp_max);
-    text_layer_destroy(speed);
-    text_layer_destroy(direction);
-    text_layer_destroy(wind_unit);
+    destroy_module_layers();
 
-    #if defined(PBL_HEALTH)
-    text_layer_destroy(steps);
-    text_layer_destroy(dist);
-    text_layer_destroy(sleep);
-    text_layer_destroy(cal);
-    text_layer_destroy(deep);
+    #if defined(TIMEBOXED_INSTRUMENT)
+    layer_destroy(render_start);
+    layer_destroy(render_end);
     #endif
 }
 
-void load_face_fonts() {
-    int selected_font = persist_exists(KEY_FONTTYPE) ? persist_read_int(KEY_FONTTYPE) : BLOCKO_FONT;
+static uint8_t select_font_ids(uint32_t *time_id, uint32_t *medium_id, uint32_t *base_id) {
+    int selected_font = storage_exists(KEY_FONTTYPE) ? storage_read_int(KEY_FONTTYPE) : BLOCKO_FONT;
 
     if (selected_font == SYSTEM_FONT) {
-        time_font = fonts_get_system_font(FONT_KEY_ROBOTO_BOLD_SUBSET_49);
-        medium_font = fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD);
-        base_font = fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD);
-        loaded_font = SYSTEM_FONT;
+        *time_id = 0;
+        *medium_id = 0;
+        *base_id = 0;
+        return SYSTEM_FONT;
     } else if (selected_font == ARCHIVO_FONT) {
-        time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_ARCHIVO_56));
-        medium_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_ARCHIVO_28));
-        base_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_ARCHIVO_18));
-        loaded_font = ARCHIVO_FONT;
+        *time_id = RESOURCE_ID_FONT_ARCHIVO_56;
+        *medium_id = RESOURCE_ID_FONT_ARCHIVO_28;
+        *base_id = RESOURCE_ID_FONT_ARCHIVO_18;
+        return ARCHIVO_FONT;
     } else if (selected_font == DIN_FONT) {
-        time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_DIN_58));
-        medium_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_DIN_26));
-        base_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_DIN_20));
-        loaded_font = DIN_FONT;
+        *time_id = RESOURCE_ID_FONT_DIN_58;
+        *medium_id = RESOURCE_ID_FONT_DIN_26;
+        *base_id = RESOURCE_ID_FONT_DIN_20;
+        return DIN_FONT;
     } else if (selected_font == PROTOTYPE_FONT) {
-        time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PROTOTYPE_48));
-        medium_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PROTOTYPE_22));
-        base_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PROTOTYPE_16));
-        loaded_font = PROTOTYPE_FONT;
+        *time_id = RESOURCE_ID_FONT_PROTOTYPE_48;
+        *medium_id = RESOURCE_ID_FONT_PROTOTYPE_22;
+        *base_id = RESOURCE_ID_FONT_PROTOTYPE_16;
+        return PROTOTYPE_FONT;
     } else if (selected_font == BLOCKO_BIG_FONT) {
-        time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_BLOCKO_64));
-        medium_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_BLOCKO_32));
-        base_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_BLOCKO_19));
-        loaded_font = BLOCKO_BIG_FONT;
-    } else {
-        time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_BLOCKO_56));
-        medium_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_BLOCKO_24));
-        base_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_BLOCKO_16));
-        loaded_font = BLOCKO_FONT;
+        *time_id = RESOURCE_ID_FONT_BLOCKO_64;
+        *medium_id = RESOURCE_ID_FONT_BLOCKO_32;
+        *base_id = RESOURCE_ID_FONT_BLOCKO_19;
+        return BLOCKO_BIG_FONT;
     }
+    *time_id = RESOURCE_ID_FONT_BLOCKO_56;
+    *medium_id = RESOURCE_ID_FONT_BLOCKO_24;
+    *base_id = RESOURCE_ID_FONT_BLOCKO_16;
+    return BLOCKO_FONT;
+}
+
+// releasing the previous fonts only after acquiring the new ones keeps the
+// ones that didn't change loaded
+static void release_previous_fonts(uint32_t *previous_ids, unsigned int count) {
+    for (unsigned int i = 0; i < count; ++i) {
+        if (previous_ids[i]) {
+            release_font(previous_ids[i]);
+        }
+    }
+}
 
-    weather_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_WEATHER_24));
-    custom_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_ICONS_20));
+// The snapshot is the last screen, painted at launch before any value is
+// recomputed: a header, then the color and the NUL terminated text of every
+// layer in text_layers order.
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_HEADER 8 // version, layer count, layout, background, int32 time saved
+#define SNAPSHOT_MAX_AGE (30 * SECONDS_PER_MINUTE)
+
+void save_snapshot() {
+    uint8_t data[PERSIST_DATA_MAX_LENGTH];
+    int32_t now = time(NULL);
+    data[0] = SNAPSHOT_VERSION;
+    data[1] = text_layer_count;
+    data[2] = get_layout_id();
+    data[3] = background_color.argb;
+    memcpy(&data[4], &now, sizeof(now));
+
+    unsigned int pos = SNAPSHOT_HEADER;
+    for (int i = 0; i < text_layer_count; ++i) {
+        size_t length = strlen(text_buffers[i]) + 1;
+        if (pos + 1 + length > sizeof(data)) {
+            APP_LOG(APP_LOG_LEVEL_WARNING, "Screen doesn't fit a snapshot");
+            storage_delete(KEY_SNAPSHOT);
+            return;
+        }
+        data[pos++] = text_colors[i].argb;
+        memcpy(&data[pos], text_buffers[i], length);
+        pos += length;
+    }
+    storage_write_data(KEY_SNAPSHOT, data, pos);
+}
+
+void discard_snapshot() {
+    storage_delete(KEY_SNAPSHOT);
+}
+
+bool paint_snapshot(Window *window) {
+    uint8_t data[PERSIST_DATA_MAX_LENGTH];
+    int length = storage_exists(KEY_SNAPSHOT) ? storage_read_data(KEY_SNAPSHOT, data, sizeof(data)) : 0;
+    if (length < SNAPSHOT_HEADER || data[0] != SNAPSHOT_VERSION ||
+            data[1] != text_layer_count || data[2] != get_layout_id()) {
+        return false;
+    }
+    int32_t saved_at;
+    memcpy(&saved_at, &data[4], sizeof(saved_at));
+    int32_t age = time(NULL) - saved_at;
+    if (age < 0 || age > SNAPSHOT_MAX_AGE) {
+        return false;
+    }
+
+    // checked whole before any of it is painted
+    int pos = SNAPSHOT_HEADER;
+    for (int i = 0; i < text_layer_count; ++i) {
+        if (pos + 1 >= length || !memchr(&data[pos + 1], '\0', length - pos - 1)) {
+            return false;
+        }
+        pos += 2 + strlen((const char *)&data[pos + 1]);
+    }
+
+    pos = SNAPSHOT_HEADER;
+    for (int i = 0; i < text_layer_count; ++i) {
+        GColor color = { .argb = data[pos] };
+        const char *text = (const char *)&data[pos + 1];
+        strncpy(text_buffers[i], text, text_sizes[i] - 1);
+        text_buffers[i][text_sizes[i] - 1] = '\0';
+        set_text_color(text_layers[i], color);
+        show_text(text_layers[i], text_buffers[i]);
+        pos += 2 + strlen(text);
+    }
+    background_color = (GColor) { .argb = data[3] };
+    window_set_background_color(window, background_color);
+    return true;
+}
+
+// the hours and date fonts, all the first frame needs
+void load_time_fonts() {
+    memory_phase_begin(PHASE_LOAD_FONTS);
+
+    uint32_t previous_ids[] = { time_font_id, medium_font_id };
+    uint32_t base_id;
+    loaded_font = select_font_ids(&time_font_id, &medium_font_id, &base_id);
+
+    time_font = time_font_id ? acquire_font(time_font_id) : fonts_get_system_font(FONT_KEY_ROBOTO_BOLD_SUBSET_49);
+    medium_font = medium_font_id ? acquire_font(medium_font_id) : fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD);
+
+    release_previous_fonts(previous_ids, ARRAY_LENGTH(previous_ids));
+
+    memory_phase_end(PHASE_LOAD_FONTS);
+}
+
+void load_secondary_fonts() {
+    memory_phase_begin(PHASE_LOAD_FONTS);
+
+    uint32_t previous_ids[] = { base_font_id, weather_font_id, custom_font_id };
+    uint32_t time_id, medium_id;
+    select_font_ids(&time_id, &medium_id, &base_font_id);
+
+    base_font = base_font_id ? acquire_font(base_font_id) : fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD);
+
+    // the weather icons are only drawn by the weather module
+    weather_font_id = is_module_enabled(MODULE_WEATHER) ? RESOURCE_ID_FONT_WEATHER_24 : 0;
+    weather_font = weather_font_id ? acquire_font(weather_font_id) : NULL;
+
+    custom_font_id = RESOURCE_ID_FONT_ICONS_20;
+    custom_font = acquire_font(custom_font_id);
+
+    release_previous_fonts(previous_ids, ARRAY_LENGTH(previous_ids));
+    log_font_cache_stats();
+
+    memory_phase_end(PHASE_LOAD_FONTS);
 }
 
 void unload_face_fonts() {
-    if (loaded_font != SYSTEM_FONT) {
-        fonts_unload_custom_font(time_font);
-        fonts_unload_custom_font(medium_font);
-        fonts_unload_custom_font(base_font);
+    uint32_t font_ids[] = { time_font_id, medium_font_id, base_font_id, weather_font_id, custom_font_id };
+    for (unsigned int i = 0; i < ARRAY_LENGTH(font_ids); ++i) {
+        if (font_ids[i]) {
+            release_font(font_ids[i]);
+        }
+    }
+    time_font_id = 0;
+    medium_font_id = 0;
+    base_font_id = 0;
+    weather_font_id = 0;
+    custom_font_id = 0;
+}
+
+void set_time_fonts() {
+    set_font(hours, time_font);
+    set_font(date, medium_font);
+}
+
+void set_secondary_fonts() {
+    set_font(alt_time, base_font);
+    set_font(battery, base_font);
+    set_font(bluetooth, custom_font);
+    set_font(update, custom_font);
+    if (weather_font) {
+        set_font(weather, weather_font);
+    }
+    set_font(min_icon, custom_font);
+    set_font(max_icon, custom_font);
+    set_font(temp_cur, base_font);
+    set_font(temp_min, base_font);
+    set_font(temp_max, base_font);
+    set_font(speed, base_font);
+    set_font(direction, custom_font);
+    set_font(wind_unit, custom_font);
+    for (int i = 0; i < WORLD_CLOCKS - 1; ++i) {
+        set_font(world_clocks[i], base_font);
     }
-    fonts_unload_custom_font(weather_font);
-    fonts_unload_custom_font(custom_font);
-}
-
-void set_face_fonts() {
-    text_layer_set_font(hours, time_font);
-    text_layer_set_font(date, medium_font);
-    text_layer_set_font(alt_time, base_font);
-    text_layer_set_font(battery, base_font);
-    text_layer_set_font(bluetooth, custom_font);
-    text_layer_set_font(update, custom_font);
-    text_layer_set_font(weather, weather_font);
-    text_layer_set_font(min_icon, custom_font);
-    text_layer_set_font(max_icon, custom_font);
-    text_layer_set_font(temp_cur, base_font);
-    text_layer_set_font(temp_min, base_font);
-    text_layer_set_font(temp_max, base_font);
-    text_layer_set_font(speed, base_font);
-    text_layer_set_font(direction, custom_font);
-    text_layer_set_font(wind_unit, custom_font);
 
     #if defined(PBL_HEALTH)
-    text_layer_set_font(steps, base_font);
-    text_layer_set_font(dist, base_font);
-    text_layer_set_font(cal, base_font);
-    text_layer_set_font(sleep, base_font);
-    text_layer_set_font(deep, base_font);
+    set_font(steps, base_font);
+    set_font(dist, base_font);
+    set_font(cal, base_font);
+    set_font(sleep, base_font);
+    set_font(deep, base_font);
     #endif
+}
 
+// until their fonts are loaded, the first frame shows only the time and date
+void set_secondary_layers_hidden(bool hidden) {
+    secondary_hidden = hidden;
+    for (int i = 0; i < text_layer_count; ++i) {
+        update_layer_hidden(i);
+    }
 }
 
-void set_colors(Window *window) {
-    base_color = persist_exists(KEY_HOURSCOLOR) ? GColorFromHEX(persist_read_int(KEY_HOURSCOLOR)) : GColorWhite;
-    text_layer_set_text_color(hours, base_color);
+void set_time_colors(Window *window) {
+    base_color = storage_exists(KEY_HOURSCOLOR) ? GColorFromHEX(storage_read_int(KEY_HOURSCOLOR)) : GColorWhite;
+    set_text_color(hours, base_color);
     enable_advanced = is_advanced_colors_enabled();
-    GColor min_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_MINCOLOR)) : base_color;
-    GColor max_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_MAXCOLOR)) : base_color;
+    set_text_color(date,
+            enable_advanced ? GColorFromHEX(storage_read_int(KEY_DATECOLOR)) : base_color);
+    background_color = storage_read_int(KEY_BGCOLOR) ? GColorFromHEX(storage_read_int(KEY_BGCOLOR)) : GColorBlack;
+    window_set_background_color(window, background_color);
+}
+
+// after set_time_colors, which reads the base color
+void set_secondary_colors() {
+    GColor min_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_MINCOLOR)) : base_color;
+    GColor max_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_MAXCOLOR)) : base_color;
 
     #if defined(PBL_HEALTH)
-    steps_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_STEPSCOLOR)) : base_color;
-    steps_behind_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_STEPSBEHINDCOLOR)) : base_color;
-    dist_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_DISTCOLOR)) : base_color;
-    dist_behind_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_DISTBEHINDCOLOR)) : base_color;
-    cal_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_CALCOLOR)) : base_color;
-    cal_behind_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_CALBEHINDCOLOR)) : base_color;
-    sleep_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_SLEEPCOLOR)) : base_color;
-    sleep_behind_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_SLEEPBEHINDCOLOR)) : base_color;
-    deep_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_DEEPCOLOR)) : base_color;
-    deep_behind_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_DEEPBEHINDCOLOR)) : base_color;
+    steps_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_STEPSCOLOR)) : base_color;
+    steps_behind_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_STEPSBEHINDCOLOR)) : base_color;
+    dist_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_DISTCOLOR)) : base_color;
+    dist_behind_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_DISTBEHINDCOLOR)) : base_color;
+    cal_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_CALCOLOR)) : base_color;
+    cal_behind_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_CALBEHINDCOLOR)) : base_color;
+    sleep_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_SLEEPCOLOR)) : base_color;
+    sleep_behind_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_SLEEPBEHINDCOLOR)) : base_color;
+    deep_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_DEEPCOLOR)) : base_color;
+    deep_behind_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_DEEPBEHINDCOLOR)) : base_color;
     #endif
 
-    text_layer_set_text_color(date,
-            enable_advanced ? GColorFromHEX(persist_read_int(KEY_DATECOLOR)) : base_color);
-    text_layer_set_text_color(alt_time,
-            enable_advanced ? GColorFromHEX(persist_read_int(KEY_ALTHOURSCOLOR)) : base_color);
-    text_layer_set_text_color(weather,
-            enable_advanced ? GColorFromHEX(persist_read_int(KEY_WEATHERCOLOR)) : base_color);
-    text_layer_set_text_color(temp_cur,
-            enable_advanced ? GColorFromHEX(persist_read_int(KEY_TEMPCOLOR)) : base_color);
-    text_layer_set_text_color(temp_min, min_color);
-    text_layer_set_text_color(min_icon, min_color);
-    text_layer_set_text_color(temp_max, max_color);
-    text_layer_set_text_color(max_icon, max_color);
-
-    text_layer_set_text_color(speed, enable_advanced ? GColorFromHEX(persist_read_int(KEY_WINDSPEEDCOLOR)) : base_color);
-    text_layer_set_text_color(wind_unit, enable_advanced ? GColorFromHEX(persist_read_int(KEY_WINDSPEEDCOLOR)) : base_color);
-    text_layer_set_text_color(direction, enable_advanced ? GColorFromHEX(persist_read_int(KEY_WINDDIRCOLOR)) : base_color);
+    GColor alt_time_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_ALTHOURSCOLOR)) : base_color;
+    set_text_color(alt_time, alt_time_color);
+    for (int i = 0; i < WORLD_CLOCKS - 1; ++i) {
+        set_text_color(world_clocks[i], alt_time_color);
+    }
+    set_text_color(weather,
+            enable_advanced ? GColorFromHEX(storage_read_int(KEY_WEATHERCOLOR)) : base_color);
+    set_text_color(temp_cur,
+            enable_advanced ? GColorFromHEX(storage_read_int(KEY_TEMPCOLOR)) : base_color);
+    set_text_color(temp_min, min_color);
+    set_text_color(min_icon, min_color);
+    set_text_color(temp_max, max_color);
+    set_text_color(max_icon, max_color);
 
-    battery_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_BATTERYCOLOR)) : base_color;
-    battery_low_color = enable_advanced ? GColorFromHEX(persist_read_int(KEY_BATTERYLOWCOLOR)) : base_color;
+    set_text_color(speed, enable_advanced ? GColorFromHEX(storage_read_int(KEY_WINDSPEEDCOLOR)) : base_color);
+    set_text_color(wind_unit, enable_advanced ? GColorFromHEX(storage_read_int(KEY_WINDSPEEDCOLOR)) : base_color);
+    set_text_color(direction, enable_advanced ? GColorFromHEX(storage_read_int(KEY_WINDDIRCOLOR)) : base_color);
 
-    window_set_background_color(window, persist_read_int(KEY_BGCOLOR) ? GColorFromHEX(persist_read_int(KEY_BGCOLOR)) : GColorBlack);
+    battery_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_BATTERYCOLOR)) : base_color;
+    battery_low_color = enable_advanced ? GColorFromHEX(storage_read_int(KEY_BATTERYLOWCOLOR)) : base_color;
 }
 
 #if defined(PBL_HEALTH)
 void set_progress_color_steps(bool falling_behind) {
-    text_layer_set_text_color(steps, falling_behind ? steps_behind_color : steps_color);
+    set_text_color(steps, falling_behind ? steps_behind_color : steps_color);
 }
 
 void set_progress_color_dist(bool falling_behind) {
-    text_layer_set_text_color(dist, falling_behind ? dist_behind_color : dist_color);
+    set_text_color(dist, falling_behind ? dist_behind_color : dist_color);
 }
 
 void set_progress_color_cal(bool falling_behind) {
-    text_layer_set_text_color(cal, falling_behind ? cal_behind_color : cal_color);
+    set_text_color(cal, falling_behind ? cal_behind_color : cal_color);
 }
 
 void set_progress_color_sleep(bool falling_behind) {
-    text_layer_set_text_color(sleep, falling_behind ? sleep_behind_color : sleep_color);
+    set_text_color(sleep, falling_behind ? sleep_behind_color : sleep_color);
 }
 
 void set_progress_color_deep(bool falling_behind) {
-    text_layer_set_text_color(deep, falling_behind ? deep_behind_color : deep_color);
+    set_text_color(deep, falling_behind ? deep_behind_color : deep_color);
 }
 #endif
 
 void set_bluetooth_color() {
-    text_layer_set_text_color(bluetooth,
-        enable_advanced && persist_exists(KEY_BLUETOOTHCOLOR) ? GColorFromHEX(persist_read_int(KEY_BLUETOOTHCOLOR)) : base_color);
+    set_text_color(bluetooth,
+        enable_advanced && storage_exists(KEY_BLUETOOTHCOLOR) ? GColorFromHEX(storage_read_int(KEY_BLUETOOTHCOLOR)) : base_color);
 }
 
 void set_update_color() {
-    text_layer_set_text_color(update,
-        enable_advanced && persist_exists(KEY_UPDATECOLOR) ? GColorFromHEX(persist_read_int(KEY_UPDATECOLOR)) : base_color);
+    set_text_color(update,
+        enable_advanced && storage_exists(KEY_UPDATECOLOR) ? GColorFromHEX(storage_read_int(KEY_UPDATECOLOR)) : base_color);
 }
 
 void set_battery_color(int percentage) {
     if (percentage > 10) {
-        text_layer_set_text_color(battery, battery_color);
+        set_text_color(battery, battery_color);
     } else {
-        text_layer_set_text_color(battery, battery_low_color);
+        set_text_color(battery, battery_low_color);
     }
 }
 
-void set_hours_layer_text(char* text) {
+void set_hours_layer_text(const char *text) {
     strcpy(hour_text, text);
-    text_layer_set_text(hours, hour_text);
+    show_text(hours, hour_text);
 }
 
-void set_date_layer_text(char* text) {
+void set_date_layer_text(const char *text) {
     strcpy(date_text, text);
-    text_layer_set_text(date, date_text);
+    show_text(date, date_text);
 }
 
-void set_alt_time_layer_text(char* text) {
+void set_alt_time_layer_text(const char *text) {
     strcpy(alt_time_text, text);
-    text_layer_set_text(alt_time, alt_time_text);
+    show_text(alt_time, alt_time_text);
+}
+
+// index counts the alt time as the first clock. Ticking every minute, a
+// clock hidden in the other mode's slots only updates its buffer.
+void set_world_clock_layer_text(int index, const char *text) {
+    strcpy(world_clock_text[index - 1], text);
+    for (int i = 0; i < text_layer_count; ++i) {
+        if (text_layers[i] == world_clocks[index - 1] && unplaced_layers[i]) {
+            return;
+        }
+    }
+    show_text(world_clocks[index - 1], world_clock_text[index - 1]);
 }
 
-void set_battery_layer_text(char* text) {
+void set_battery_layer_text(const char *text) {
     strcpy(battery_text, text);
-    text_layer_set_text(battery, battery_text);
+    show_text(battery, battery_text);
 }
 
-void set_bluetooth_layer_text(char* text) {
+void set_bluetooth_layer_text(const char *text) {
     strcpy(bluetooth_text, text);
-    text_layer_set_text(bluetooth, bluetooth_text);
+    show_text(bluetooth, bluetooth_text);
 }
 
-void set_temp_cur_layer_text(char* text) {
+void set_temp_cur_layer_text(const char *text) {
     strcpy(temp_cur_text, text);
-    text_layer_set_text(temp_cur, temp_cur_text);
+    show_text(temp_cur, temp_cur_text);
 }
 
-void set_temp_max_layer_text(char* text) {
+void set_temp_max_layer_text(const char *text) {
     strcpy(temp_max_text, text);
-    text_layer_set_text(temp_max, temp_max_text);
+    show_text(temp_max, temp_max_text);
 }
 
-void set_temp_min_layer_text(char* text) {
+void set_temp_min_layer_text(const char *text) {
     strcpy(temp_min_text, text);
-    text_layer_set_text(temp_min, temp_min_text);
+    show_text(temp_min, temp_min_text);
 }
 
 #if defined(PBL_HEALTH)
-void set_steps_layer_text(char* text) {
+void set_steps_layer_text(const char *text) {
     strcpy(steps_text, text);
-    text_layer_set_text(steps, steps_text);
+    show_text(steps, steps_text);
 }
 
-void set_dist_layer_text(char* text) {
+void set_dist_layer_text(const char *text) {
     strcpy(dist_text, text);
-    text_layer_set_text(dist, dist_text);
+    show_text(dist, dist_text);
 }
 
-void set_cal_layer_text(char* text) {
+void set_cal_layer_text(const char *text) {
     strcpy(cal_text, text);
-    text_layer_set_text(cal, cal_text);
+    show_text(cal, cal_text);
 }
 
-void set_sleep_layer_text(char* text) {
+void set_sleep_layer_text(const char *text) {
     strcpy(sleep_text, text);
-    text_layer_set_text(sleep, sleep_text);
+    show_text(sleep, sleep_text);
 }
 
-void set_deep_layer_text(char* text) {
+void set_deep_layer_text(const char *text) {
     strcpy(deep_text, text);
-    text_layer_set_text(deep, deep_text);
+    show_text(deep, deep_text);
 }
 #endif
 
-void set_weather_layer_text(char* text) {
+void set_weather_layer_text(const char *text) {
     strcpy(weather_text, text);
-    text_layer_set_text(weather, weather_text);
+    show_text(weather, weather_text);
 }
 
-void set_max_icon_layer_text(char* text) {
+void set_max_icon_layer_text(const char *text) {
     strcpy(max_icon_text, text);
-    text_layer_set_text(max_icon, max_icon_text);
+    show_text(max_icon, max_icon_text);
 }
 
-void set_min_icon_layer_text(char* text) {
+void set_min_icon_layer_text(const char *text) {
     strcpy(min_icon_text, text);
-    text_layer_set_text(min_icon, min_icon_text);
+    show_text(min_icon, min_icon_text);
 }
 
-void set_update_layer_text(char* text) {
+void set_update_layer_text(const char *text) {
     strcpy(update_text, text);
-    text_layer_set_text(update, update_text);
+    show_text(update, update_text);
 }
 
-void set_wind_speed_layer_text(char* text) {
+void set_wind_speed_layer_text(const char *text) {
     strcpy(speed_text, text);
-    text_layer_set_text(speed, speed_text);
+    show_text(speed, speed_text);
 }
 
-void set_wind_direction_layer_text(char* text) {
+void set_wind_direction_layer_text(const char *text) {
     strcpy(direction_text, text);
-    text_layer_set_text(direction, direction_text);
+    show_text(direction, direction_text);
 }
 
-void set_wind_unit_layer_text(char* text) {
+void set_wind_unit_layer_text(const char *text) {
     strcpy(wind_unit_text, text);
-    text_layer_set_text(wind_unit, wind_unit_text);
+    show_text(wind_unit, wind_unit_text);
 }
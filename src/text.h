@@ -6,14 +6,31 @@
 void create_text_layers(Window*);
 
 void destroy_text_layers();
+void reflow_text_layers(int16_t);
 
-void load_face_fonts();
+void set_secondary_layers_hidden(bool);
+
+void save_snapshot();
+void discard_snapshot();
+bool paint_snapshot(Window*);
+
+void load_time_fonts();
+void load_secondary_fonts();
 void unload_face_fonts();
-void set_face_fonts();
-void set_colors(Window*);
+void set_time_fonts();
+void set_secondary_fonts();
+void set_time_colors(Window*);
+void set_secondary_colors();
 
 uint8_t get_loaded_font();
 
+void create_module_text_layers(int module, Layer *window_layer);
+void layout_module_text_layers(int module, int awake_slot, int asleep_slot);
+void place_module_text_layers(int module, bool asleep);
+void destroy_module_text_layers(int module);
+void relayout_text_layers();
+const char *get_module_text(int module);
+
 void set_progress_color_steps(bool);
 void set_progress_color_dist(bool);
 void set_progress_color_cal(bool);
@@ -23,29 +40,30 @@ void set_bluetooth_color();
 void set_update_color();
 void set_battery_color();
 
-void set_hours_layer_text(char*);
-void set_date_layer_text(char*);
-void set_alt_time_layer_text(char*);
-void set_battery_layer_text(char*);
-void set_bluetooth_layer_text(char*);
-void set_temp_cur_layer_text(char*);
-void set_temp_max_layer_text(char*);
-void set_temp_min_layer_text(char*);
+void set_hours_layer_text(const char*);
+void set_date_layer_text(const char*);
+void set_alt_time_layer_text(const char*);
+void set_world_clock_layer_text(int, const char*);
+void set_battery_layer_text(const char*);
+void set_bluetooth_layer_text(const char*);
+void set_temp_cur_layer_text(const char*);
+void set_temp_max_layer_text(const char*);
+void set_temp_min_layer_text(const char*);
 
 #if defined(PBL_HEALTH)
-void set_steps_layer_text(char*);
-void set_dist_layer_text(char*);
-void set_cal_layer_text(char*);
-void set_sleep_layer_text(char*);
-void set_deep_layer_text(char*);
+void set_steps_layer_text(const char*);
+void set_dist_layer_text(const char*);
+void set_cal_layer_text(const char*);
+void set_sleep_layer_text(const char*);
+void set_deep_layer_text(const char*);
 #endif
 
-void set_weather_layer_text(char*);
-void set_max_icon_layer_text(char*);
-void set_min_icon_layer_text(char*);
-void set_update_layer_text(char*);
-void set_wind_speed_layer_text(char*);
-void set_wind_direction_layer_text(char*);
-void set_wind_unit_layer_text(char*);
+void set_weather_layer_text(const char*);
+void set_max_icon_layer_text(const char*);
+void set_min_icon_layer_text(const char*);
+void set_update_layer_text(const char*);
+void set_wind_speed_layer_text(const char*);
+void set_wind_direction_layer_text(const char*);
+void set_wind_unit_layer_text(const char*);
 
 #endif
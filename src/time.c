@@ -3,89 +3,317 @@
 #include "text.h"
 #include "locales.h"
 #include "configs.h"
+#include "modules.h"
 #include "keys.h"
+#include "profiler.h"
+#include "storage.h"
 
-static signed int tz_hour;
-static uint8_t tz_minute;
-static char tz_name[TZ_LEN];
+// The alt time and the clocks shown in slots. All of them come from the
+// same time(NULL) and one localtime per tick: each clock is an offset from
+// UTC, so its hour and day are plain arithmetic on the epoch seconds.
+#define TOPUP_RETRY_BUSY SECONDS_PER_MINUTE // the outbox was taken
+#define TOPUP_RETRY_UNANSWERED SECONDS_PER_HOUR
 
-void update_time() {
-    // Get a tm structure
-    time_t temp = time(NULL);
-    struct tm *tick_time = localtime(&temp);
-    struct tm *gmt_time = gmtime(&temp);
-    gmt_time->tm_hour = gmt_time->tm_hour + tz_hour;
-    mktime(gmt_time);
-    gmt_time->tm_min = gmt_time->tm_min + (tz_hour >= 0 ? tz_minute : -1*tz_minute);
-    mktime(gmt_time);
-    char tz_text[22];
-    char hour_text[13];
-    char date_text[13];
-
-    if (is_leading_zero_disabled()) {
-        strftime(hour_text, sizeof(hour_text), (clock_is_24h_style() ? "%k:%M" : "%l:%M"), tick_time);
-        if (hour_text[0] == ' ') {
-            for (int i = 0; i < 12; ++i) {
-                hour_text[i] = hour_text[i+1];
-            }
-            hour_text[12] = '\0';
-        }
+struct WorldClock {
+    char name[TZ_NAME_LEN];
+    int32_t fixed_offset; // from the config, used without a table
+    bool enabled;
+
+    // UTC offsets from the phone: the first entry is the one in effect
+    // when the table was made, then the upcoming transitions. The cursor
+    // only moves when time passes next_change, which is also the next
+    // top-up attempt while the table runs low.
+    int32_t transition_at[TZ_TRANSITIONS];
+    int16_t transition_offset[TZ_TRANSITIONS];
+    uint8_t transition_count;
+    uint8_t cursor;
+    time_t topup_after; // no top-up request before this
+    time_t next_change;
+    int32_t offset;
+
+    uint8_t minute;
+    uint8_t minute_pos;
+};
+
+struct WorldClockKeys {
+    uint32_t hour;
+    uint32_t minutes;
+    uint32_t code;
+    uint32_t transitions;
+    int module; // the slot module showing it, MODULE_NONE for the alt time
+};
+
+static const struct WorldClockKeys clock_keys[WORLD_CLOCKS] = {
+    { KEY_TIMEZONES, KEY_TIMEZONESMINUTES, KEY_TIMEZONESCODE, KEY_TZTRANSITIONS, MODULE_NONE },
+    { KEY_TIMEZONES2, KEY_TIMEZONES2MINUTES, KEY_TIMEZONES2CODE, KEY_TZTRANSITIONS2, MODULE_TIMEZONE2 },
+    { KEY_TIMEZONES3, KEY_TIMEZONES3MINUTES, KEY_TIMEZONES3CODE, KEY_TZTRANSITIONS3, MODULE_TIMEZONE3 },
+};
+
+static struct WorldClock clocks[WORLD_CLOCKS];
+
+// Last formatted texts, all world clocks in one fixed arena. Within an hour
+// only the minute digits change, so those are rewritten in place; a text is
+// recomputed when its hour rolls over, and all of them when the local hour
+// does, a minute is skipped, or invalidate_time_fields is called.
+static char hour_text[13];
+static char clock_texts[WORLD_CLOCKS][WORLD_CLOCK_TEXT_LEN];
+static char date_text[13];
+static struct tm local_time;
+static int32_t local_day;
+static int32_t minute_stamp = -1;
+static uint8_t hour_minute_pos;
+
+static void write_minutes(char *text, uint8_t pos, int minutes) {
+    text[pos] = '0' + minutes / 10;
+    text[pos + 1] = '0' + minutes % 10;
+}
+
+// writes H:MM or HH:MM (plus AM/PM if asked on 12h clocks), returning
+// where the minutes are
+static uint8_t format_clock(char *text, int hour_of_day, int minute, bool with_period) {
+    bool is_24h = clock_is_24h_style();
+    int hour = is_24h ? hour_of_day : (hour_of_day % 12 ? hour_of_day % 12 : 12);
+    uint8_t i = 0;
+    if (hour >= 10 || !is_leading_zero_disabled()) {
+        text[i++] = '0' + hour / 10;
+    }
+    text[i++] = '0' + hour % 10;
+    text[i++] = ':';
+    uint8_t minute_pos = i;
+    write_minutes(text, minute_pos, minute);
+    i += 2;
+    if (with_period && !is_24h) {
+        text[i++] = hour_of_day < 12 ? 'A' : 'P';
+        text[i++] = 'M';
+    }
+    text[i] = '\0';
+    return minute_pos;
+}
+
+// days since the epoch of a broken-down date
+static int32_t day_number(const struct tm *t) {
+    int32_t year = t->tm_year + 1900;
+    int32_t before = year - 1;
+    int32_t leaps = (before / 4 - before / 100 + before / 400) - (1969 / 4 - 1969 / 100 + 1969 / 400);
+    return (year - 1970) * 365 + leaps + t->tm_yday;
+}
+
+static void show_world_clock(int index) {
+    if (index == 0) {
+        set_alt_time_layer_text(clock_texts[index]);
     } else {
-        strftime(hour_text, sizeof(hour_text), (clock_is_24h_style() ? "%H:%M" : "%I:%M"), tick_time);
+        set_world_clock_layer_text(index, clock_texts[index]);
+    }
+}
+
+// asked again later until the table arrives, see select_timezone_offset
+static void request_timezone_transitions(int index, time_t now) {
+    DictionaryIterator *iter;
+    if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+        clocks[index].topup_after = now + TOPUP_RETRY_BUSY;
+        return;
     }
+    dict_write_uint8(iter, KEY_TZTRANSITIONS, index + 1);
+    app_message_outbox_send();
+    clocks[index].topup_after = now + TOPUP_RETRY_UNANSWERED;
+}
 
-    if (is_timezone_enabled()) {
-        if (is_leading_zero_disabled()) {
-            strftime(tz_text, sizeof(tz_text), (clock_is_24h_style() ? "%k:%M" : "%l:%M%p"), gmt_time);
-            if (tz_text[0] == ' ') {
-                for (int i = 0; i < 12; ++i) {
-                    tz_text[i] = tz_text[i+1];
-                }
-                tz_text[12] = '\0';
-            }
-        } else {
-            strftime(tz_text, sizeof(tz_text), (clock_is_24h_style() ? "%H:%M" : "%I:%M%p"), gmt_time);
-        }
+static void select_timezone_offset(int index, time_t now) {
+    struct WorldClock *clock = &clocks[index];
+    if (clock->transition_count == 0) {
+        clock->offset = clock->fixed_offset;
+        clock->next_change = INT32_MAX;
+        return;
+    }
+    while (clock->cursor + 1 < clock->transition_count && clock->transition_at[clock->cursor + 1] <= now) {
+        clock->cursor++;
+    }
+    clock->offset = clock->transition_offset[clock->cursor] * SECONDS_PER_MINUTE;
+    clock->next_change = clock->cursor + 1 < clock->transition_count ? clock->transition_at[clock->cursor + 1] : INT32_MAX;
 
-        if ((gmt_time->tm_year == tick_time->tm_year && gmt_time->tm_mon == tick_time->tm_mon && gmt_time->tm_mday > tick_time->tm_mday) ||
-            (gmt_time->tm_year == tick_time->tm_year && gmt_time->tm_mon > tick_time->tm_mon) ||
-            (gmt_time->tm_year > tick_time->tm_year)
-        ) {
-                strcat(tz_text, "+1");
-        } else if ((gmt_time->tm_year == tick_time->tm_year && gmt_time->tm_mon == tick_time->tm_mon && gmt_time->tm_mday < tick_time->tm_mday) ||
-            (gmt_time->tm_year == tick_time->tm_year && gmt_time->tm_mon < tick_time->tm_mon) ||
-            (gmt_time->tm_year < tick_time->tm_year)
-        ) {
-            strcat(tz_text, "-1");
+    if (clock->transition_count - clock->cursor - 1 < TZ_TRANSITIONS_LOW) {
+        if (now >= clock->topup_after) {
+            request_timezone_transitions(index, now);
+        }
+        if (clock->topup_after < clock->next_change) {
+            clock->next_change = clock->topup_after;
         }
+    }
+}
 
-        strcat(tz_text, " ");
-        strcat(tz_text, tz_name);
+static void format_world_clock(int index, time_t now) {
+    struct WorldClock *clock = &clocks[index];
+    char *text = clock_texts[index];
+    if (now >= clock->next_change) {
+        select_timezone_offset(index, now);
+    }
 
-        for (unsigned char i = 0; tz_text[i]; ++i) {
-            tz_text[i] = toupper((unsigned char)tz_text[i]);
-        }
+    time_t alt = now + clock->offset;
+    int32_t seconds = alt % SECONDS_PER_DAY;
+    clock->minute = seconds / SECONDS_PER_MINUTE % MINUTES_PER_HOUR;
+    clock->minute_pos = format_clock(text, seconds / SECONDS_PER_HOUR, clock->minute, true);
+
+    uint8_t i = strlen(text);
+    int32_t delta = alt / SECONDS_PER_DAY - local_day;
+    if (delta != 0) {
+        text[i++] = delta > 0 ? '+' : '-';
+        text[i++] = '1';
+    }
+    text[i++] = ' ';
+    strcpy(text + i, clock->name);
+}
 
-        set_alt_time_layer_text(tz_text);
+// one minute later than the last format
+static void tick_world_clock(int index, time_t now) {
+    struct WorldClock *clock = &clocks[index];
+    if (clock->minute < 59 && now < clock->next_change) {
+        write_minutes(clock_texts[index], clock->minute_pos, ++clock->minute);
     } else {
-        set_alt_time_layer_text("");
+        format_world_clock(index, now);
     }
+}
+
+static bool is_world_clock_enabled(int index) {
+    if (index == 0) {
+        return is_timezone_enabled();
+    }
+    return clocks[index].name[0] != '\0' && is_module_enabled(clock_keys[index].module);
+}
 
+static void format_all(time_t now) {
+    int32_t previous_day = local_day;
+    bool date_changed = minute_stamp < 0;
+
+    local_time = *localtime(&now);
+    local_day = day_number(&local_time);
+    hour_minute_pos = format_clock(hour_text, local_time.tm_hour, local_time.tm_min, false);
     set_hours_layer_text(hour_text);
-    get_current_date(tick_time, date_text, sizeof(date_text), 1);
-    set_date_layer_text(date_text);
+
+    for (int i = 0; i < WORLD_CLOCKS; ++i) {
+        bool was_enabled = clocks[i].enabled;
+        clocks[i].enabled = is_world_clock_enabled(i);
+        if (clocks[i].enabled) {
+            format_world_clock(i, now);
+            show_world_clock(i);
+        } else if (was_enabled || date_changed) {
+            clock_texts[i][0] = '\0';
+            show_world_clock(i);
+        }
+    }
+
+    if (date_changed || local_day != previous_day) {
+        get_current_date(&local_time, date_text, sizeof(date_text), 1);
+        set_date_layer_text(date_text);
+    }
+}
+
+void invalidate_time_fields() {
+    minute_stamp = -1;
+    for (int i = 0; i < WORLD_CLOCKS; ++i) {
+        clocks[i].next_change = 0;
+    }
+}
+
+void update_time() {
+    uint32_t start = profile_begin();
+
+    time_t now = time(NULL);
+    int32_t stamp = now / SECONDS_PER_MINUTE;
+
+    if (stamp == minute_stamp) {
+        profile_end(PROFILE_UPDATE_TIME, start);
+        return;
+    }
+
+    if (minute_stamp >= 0 && stamp == minute_stamp + 1 && local_time.tm_min < 59) {
+        write_minutes(hour_text, hour_minute_pos, ++local_time.tm_min);
+        set_hours_layer_text(hour_text);
+        for (int i = 0; i < WORLD_CLOCKS; ++i) {
+            if (clocks[i].enabled) {
+                tick_world_clock(i, now);
+                show_world_clock(i);
+            }
+        }
+    } else {
+        format_all(now);
+    }
+    minute_stamp = stamp;
+
+    profile_end(PROFILE_UPDATE_TIME, start);
+}
+
+static void uppercase_name(char *name) {
+    for (unsigned char i = 0; name[i]; ++i) {
+        name[i] = toupper((unsigned char)name[i]);
+    }
+}
+
+static int32_t read_int32(const uint8_t *data) {
+    return (int32_t)(data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24);
+}
+
+static void load_timezone_transitions(int index, const uint8_t *data, int length) {
+    struct WorldClock *clock = &clocks[index];
+    clock->transition_count = 0;
+    for (int i = 0; i + TZ_TRANSITION_SIZE <= length && clock->transition_count < TZ_TRANSITIONS; i += TZ_TRANSITION_SIZE) {
+        clock->transition_at[clock->transition_count] = read_int32(data + i);
+        clock->transition_offset[clock->transition_count] = (int16_t)(data[i + 4] | data[i + 5] << 8);
+        clock->transition_count++;
+    }
+    clock->cursor = 0;
+    clock->topup_after = 0;
+    invalidate_time_fields();
+}
+
+static void set_fixed_offset(int index, int hour, int minute) {
+    clocks[index].fixed_offset = hour * SECONDS_PER_HOUR + (hour >= 0 ? minute : -1 * minute) * SECONDS_PER_MINUTE;
+}
+
+bool process_timezone_transitions(DictionaryIterator *iter) {
+    bool found = false;
+    for (int i = 0; i < WORLD_CLOCKS; ++i) {
+        Tuple *transitions = dict_find(iter, clock_keys[i].transitions);
+        if (transitions) {
+            storage_write_data(clock_keys[i].transitions, transitions->value->data, transitions->length);
+            load_timezone_transitions(i, transitions->value->data, transitions->length);
+            found = true;
+        }
+    }
+    return found;
 }
 
 void load_timezone_from_storage() {
-    if (is_timezone_enabled() && persist_exists(KEY_TIMEZONESCODE)) {
-        persist_read_string(KEY_TIMEZONESCODE, tz_name, sizeof(tz_name));
-        tz_hour = persist_exists(KEY_TIMEZONES) ? persist_read_int(KEY_TIMEZONES) : 0;
-        tz_minute = persist_exists(KEY_TIMEZONESMINUTES) ? persist_read_int(KEY_TIMEZONESMINUTES) : 0;
+    for (int i = 0; i < WORLD_CLOCKS; ++i) {
+        const struct WorldClockKeys *keys = &clock_keys[i];
+        struct WorldClock *clock = &clocks[i];
+        if (!storage_exists(keys->code)) {
+            continue;
+        }
+        storage_read_string(keys->code, clock->name, sizeof(clock->name));
+        uppercase_name(clock->name);
+        set_fixed_offset(i,
+            storage_exists(keys->hour) ? storage_read_int(keys->hour) : 0,
+            storage_exists(keys->minutes) ? storage_read_int(keys->minutes) : 0);
+
+        uint8_t table[TZ_TRANSITIONS * TZ_TRANSITION_SIZE];
+        int length = storage_exists(keys->transitions) ? storage_read_data(keys->transitions, table, sizeof(table)) : 0;
+        load_timezone_transitions(i, table, length);
     }
 }
 
-void set_timezone(char *name, int hour, int minute) {
-   strcpy(tz_name, name);
-   tz_hour = hour;
-   tz_minute = minute;
+void set_world_clock(int index, char *name, int hour, int minute) {
+    struct WorldClock *clock = &clocks[index];
+    char previous_name[TZ_NAME_LEN];
+    int32_t previous_offset = clock->fixed_offset;
+    strcpy(previous_name, clock->name);
+    strncpy(clock->name, name, sizeof(clock->name) - 1);
+    clock->name[sizeof(clock->name) - 1] = '\0';
+    uppercase_name(clock->name);
+    set_fixed_offset(index, hour, minute);
+    if (strcmp(previous_name, clock->name) == 0 && previous_offset == clock->fixed_offset) {
+        return; // the same zone, its table stays
+    }
+    // a table for the previous zone no longer applies
+    storage_delete(clock_keys[index].transitions);
+    load_timezone_transitions(index, NULL, 0);
 }
@@ -1,9 +1,12 @@
 #ifndef __TIMEBOXED_TIME_
 #define __TIMEBOXED_TIME_
 
+#include <pebble.h>
+
 void update_time();
+void invalidate_time_fields();
 void load_timezone_from_storage();
-void set_timezone(char *name, int hour, int minute);
+void set_world_clock(int index, char *name, int hour, int minute);
+bool process_timezone_transitions(DictionaryIterator *iter);
 
 #endif
-
@@ -6,14 +6,85 @@
 #include "text.h"
 #include "weather.h"
 #include "configs.h"
+#include "modules.h"
 #include "positions.h"
 #include "screen.h"
+#include "time.h"
+#include "memory.h"
+#include "profiler.h"
+#include "storage.h"
+#include "power.h"
+#include "scheduler.h"
+#include "healthlog.h"
+#include "energy.h"
+
+#if defined(TIMEBOXED_INSTRUMENT) || defined(PBL_HEALTH)
+#define OUTBOX_SIZE 256 // room for the diagnostics reports and a health batch
+#else
+#define OUTBOX_SIZE 128 // the energy report
+#endif
+#define INBOX_SIZE 768 // a full config, about 630 bytes
 
 static Window *watchface;
 
-static uint8_t min_counter;
+// the slot clocks, shown when their module is in a slot
+static void process_world_clock(DictionaryIterator *iterator, int index, uint32_t hour_key, uint32_t minutes_key, uint32_t code_key) {
+    Tuple *hour = dict_find(iterator, hour_key);
+    Tuple *minutes = dict_find(iterator, minutes_key);
+    Tuple *code = dict_find(iterator, code_key);
+    if (!hour || !code) {
+        return;
+    }
+    signed int tz_hour = hour->value->int8;
+    int tz_minute = minutes ? minutes->value->int8 : 0;
+    // as for the alt time, a # code leaves the clock off
+    char *tz_code = code->value->cstring[0] != '#' ? code->value->cstring : "";
+    storage_write_int(hour_key, tz_hour);
+    storage_write_int(minutes_key, tz_minute);
+    storage_write_string(code_key, tz_code);
+    set_world_clock(index, tz_code, tz_hour, tz_minute);
+}
+
+static void process_inbox(DictionaryIterator *iterator) {
+    Tuple *diagnostics_tuple = dict_find(iterator, KEY_DIAGNOSTICS);
+    if (diagnostics_tuple) {
+        switch (diagnostics_tuple->value->int8) {
+            case DIAGNOSTICS_MEMORY:
+                log_memory_report();
+                break;
+            case DIAGNOSTICS_PROFILE:
+                send_profile_report();
+                break;
+            case DIAGNOSTICS_STORAGE:
+                log_storage_report();
+                break;
+            case DIAGNOSTICS_POWER:
+                log_power_report();
+                break;
+            case DIAGNOSTICS_SCHEDULER:
+                log_scheduler_report();
+                break;
+            case DIAGNOSTICS_HEALTHLOG:
+                log_health_log_report();
+                break;
+            case DIAGNOSTICS_ENERGY: {
+                Tuple *costs_tuple = dict_find(iterator, KEY_ENERGYCOSTS);
+                if (costs_tuple) {
+                    set_energy_costs(costs_tuple->value->data, costs_tuple->length);
+                }
+                send_energy_report();
+                break;
+            }
+        }
+        return;
+    }
+
+    if (process_timezone_transitions(iterator)) {
+        // sent after each config change and whenever the watch runs low
+        update_time();
+        return;
+    }
 
-static void inbox_received_callback(DictionaryIterator *iterator, void *context) {
     Tuple *error_tuple = dict_find(iterator, KEY_ERROR);
 
     if (error_tuple) {
@@ -24,7 +95,7 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
     Tuple *update_tuple = dict_find(iterator, KEY_HASUPDATE);
     if (update_tuple) {
         int update_val = update_tuple->value->int8;
-        persist_write_int(KEY_HASUPDATE, update_val);
+        storage_write_int(KEY_HASUPDATE, update_val);
         notify_update(update_val);
         return;
     }
@@ -56,10 +127,12 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
         return;
     }
 
+    memory_phase_begin(PHASE_APPLY_CONFIG);
+
     int configs = 0;
     signed int tz_hour = 0;
     uint8_t tz_minute = 0;
-    static char tz_name[TZ_LEN];
+    static char tz_name[TZ_NAME_LEN];
 
     Tuple *enableHealth = dict_find(iterator, KEY_ENABLEHEALTH);
     if (enableHealth) {
@@ -100,33 +173,33 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
     Tuple *timezones = dict_find(iterator, KEY_TIMEZONES);
     if (timezones) {
         signed int tz = timezones->value->int8;
-        persist_write_int(KEY_TIMEZONES, tz);
+        storage_write_int(KEY_TIMEZONES, tz);
         tz_hour = tz;
     }
 
     Tuple *timezonesMin = dict_find(iterator, KEY_TIMEZONESMINUTES);
     if (timezonesMin) {
         int tz_min = timezonesMin->value->int8;
-        persist_write_int(KEY_TIMEZONESMINUTES, tz_min);
+        storage_write_int(KEY_TIMEZONESMINUTES, tz_min);
         tz_minute = tz_min;
     }
 
     Tuple *timezonesCode = dict_find(iterator, KEY_TIMEZONESCODE);
     if (timezones) {
         char* tz_code = timezonesCode->value->cstring;
-        persist_write_string(KEY_TIMEZONESCODE, tz_code);
+        storage_write_string(KEY_TIMEZONESCODE, tz_code);
         strcpy(tz_name, tz_code);
         if (tz_code[0] != '#') configs += FLAG_TIMEZONES;
     }
 
     Tuple *bgColor = dict_find(iterator, KEY_BGCOLOR);
     if (bgColor) {
-        persist_write_int(KEY_BGCOLOR, bgColor->value->int32);
+        storage_write_int(KEY_BGCOLOR, bgColor->value->int32);
     }
 
     Tuple *hoursColor = dict_find(iterator, KEY_HOURSCOLOR);
     if (hoursColor) {
-        persist_write_int(KEY_HOURSCOLOR, hoursColor->value->int32);
+        storage_write_int(KEY_HOURSCOLOR, hoursColor->value->int32);
     }
 
     Tuple *enableAdvanced = dict_find(iterator, KEY_ENABLEADVANCED);
@@ -137,109 +210,119 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
 
     Tuple *dateColor = dict_find(iterator, KEY_DATECOLOR);
     if (dateColor) {
-        persist_write_int(KEY_DATECOLOR, dateColor->value->int32);
+        storage_write_int(KEY_DATECOLOR, dateColor->value->int32);
     }
 
     Tuple *altHoursColor = dict_find(iterator, KEY_ALTHOURSCOLOR);
     if (altHoursColor) {
-        persist_write_int(KEY_ALTHOURSCOLOR, altHoursColor->value->int32);
+        storage_write_int(KEY_ALTHOURSCOLOR, altHoursColor->value->int32);
     }
 
     Tuple *batteryColor = dict_find(iterator, KEY_BATTERYCOLOR);
     if (batteryColor) {
-        persist_write_int(KEY_BATTERYCOLOR, batteryColor->value->int32);
+        storage_write_int(KEY_BATTERYCOLOR, batteryColor->value->int32);
     }
 
     Tuple *batteryLowColor = dict_find(iterator, KEY_BATTERYLOWCOLOR);
     if (batteryLowColor) {
-        persist_write_int(KEY_BATTERYLOWCOLOR, batteryLowColor->value->int32);
+        storage_write_int(KEY_BATTERYLOWCOLOR, batteryLowColor->value->int32);
     }
 
     Tuple *weatherColor = dict_find(iterator, KEY_WEATHERCOLOR);
     if (weatherColor) {
-        persist_write_int(KEY_WEATHERCOLOR, weatherColor->value->int32);
+        storage_write_int(KEY_WEATHERCOLOR, weatherColor->value->int32);
     }
 
     Tuple *tempColor = dict_find(iterator, KEY_TEMPCOLOR);
     if (tempColor) {
-        persist_write_int(KEY_TEMPCOLOR, tempColor->value->int32);
+        storage_write_int(KEY_TEMPCOLOR, tempColor->value->int32);
     }
 
     Tuple *minColor = dict_find(iterator, KEY_MINCOLOR);
     if (minColor) {
-        persist_write_int(KEY_MINCOLOR, minColor->value->int32);
+        storage_write_int(KEY_MINCOLOR, minColor->value->int32);
     }
 
     Tuple *maxColor = dict_find(iterator, KEY_MAXCOLOR);
     if (maxColor) {
-        persist_write_int(KEY_MAXCOLOR, maxColor->value->int32);
+        storage_write_int(KEY_MAXCOLOR, maxColor->value->int32);
     }
 
     Tuple *windDirColor = dict_find(iterator, KEY_WINDDIRCOLOR);
     if (windDirColor) {
-        persist_write_int(KEY_WINDDIRCOLOR, windDirColor->value->int32);
+        storage_write_int(KEY_WINDDIRCOLOR, windDirColor->value->int32);
     }
 
     Tuple *windSpeedColor = dict_find(iterator, KEY_WINDSPEEDCOLOR);
     if (windSpeedColor) {
-        persist_write_int(KEY_WINDSPEEDCOLOR, windSpeedColor->value->int32);
+        storage_write_int(KEY_WINDSPEEDCOLOR, windSpeedColor->value->int32);
     }
 
     #if defined(PBL_HEALTH)
     Tuple *stepsColor = dict_find(iterator, KEY_STEPSCOLOR);
     if (stepsColor) {
-        persist_write_int(KEY_STEPSCOLOR, stepsColor->value->int32);
+        storage_write_int(KEY_STEPSCOLOR, stepsColor->value->int32);
     }
 
     Tuple *distColor = dict_find(iterator, KEY_DISTCOLOR);
     if (distColor) {
-        persist_write_int(KEY_DISTCOLOR, distColor->value->int32);
+        storage_write_int(KEY_DISTCOLOR, distColor->value->int32);
     }
 
     Tuple *calColor = dict_find(iterator, KEY_CALCOLOR);
     if (calColor) {
-        persist_write_int(KEY_CALCOLOR, calColor->value->int32);
+        storage_write_int(KEY_CALCOLOR, calColor->value->int32);
     }
 
     Tuple *sleepColor = dict_find(iterator, KEY_SLEEPCOLOR);
     if (sleepColor) {
-        persist_write_int(KEY_SLEEPCOLOR, sleepColor->value->int32);
+        storage_write_int(KEY_SLEEPCOLOR, sleepColor->value->int32);
     }
 
     Tuple *deepColor = dict_find(iterator, KEY_DEEPCOLOR);
     if (deepColor) {
-        persist_write_int(KEY_DEEPCOLOR, deepColor->value->int32);
+        storage_write_int(KEY_DEEPCOLOR, deepColor->value->int32);
     }
 
     Tuple *stepsBehindColor = dict_find(iterator, KEY_STEPSBEHINDCOLOR);
     if (stepsBehindColor) {
-        persist_write_int(KEY_STEPSBEHINDCOLOR, stepsBehindColor->value->int32);
+        storage_write_int(KEY_STEPSBEHINDCOLOR, stepsBehindColor->value->int32);
     }
 
     Tuple *distBehindColor = dict_find(iterator, KEY_DISTBEHINDCOLOR);
     if (distBehindColor) {
-        persist_write_int(KEY_DISTBEHINDCOLOR, distBehindColor->value->int32);
+        storage_write_int(KEY_DISTBEHINDCOLOR, distBehindColor->value->int32);
     }
 
     Tuple *calBehindColor = dict_find(iterator, KEY_CALBEHINDCOLOR);
     if (calBehindColor) {
-        persist_write_int(KEY_CALBEHINDCOLOR, calBehindColor->value->int32);
+        storage_write_int(KEY_CALBEHINDCOLOR, calBehindColor->value->int32);
     }
 
     Tuple *sleepBehindColor = dict_find(iterator, KEY_SLEEPBEHINDCOLOR);
     if (sleepBehindColor) {
-        persist_write_int(KEY_SLEEPBEHINDCOLOR, sleepBehindColor->value->int32);
+        storage_write_int(KEY_SLEEPBEHINDCOLOR, sleepBehindColor->value->int32);
     }
 
     Tuple *deepBehindColor = dict_find(iterator, KEY_DEEPBEHINDCOLOR);
     if (deepBehindColor) {
-        persist_write_int(KEY_DEEPBEHINDCOLOR, deepBehindColor->value->int32);
+        storage_write_int(KEY_DEEPBEHINDCOLOR, deepBehindColor->value->int32);
+    }
+
+    Tuple *healthLog = dict_find(iterator, KEY_HEALTHLOG);
+    if (healthLog) {
+        storage_write_int(KEY_HEALTHLOG, healthLog->value->int8);
+    }
+
+    Tuple *healthLogRecords = dict_find(iterator, KEY_HEALTHLOGRECORDS);
+    if (healthLogRecords) {
+        storage_write_int(KEY_HEALTHLOGRECORDS, healthLogRecords->value->int8);
     }
     #endif
 
     Tuple *fontType = dict_find(iterator, KEY_FONTTYPE);
     if (fontType) {
-        persist_write_int(KEY_FONTTYPE, fontType->value->int8);
+        storage_write_int(KEY_FONTTYPE, fontType->value->int8);
     }
 
     Tuple *bluetoothDisconnect = dict_find(iterator, KEY_BLUETOOTHDISCONNECT);
@@ -250,12 +333,12 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
 
     Tuple *bluetoothColor = dict_find(iterator, KEY_BLUETOOTHCOLOR);
     if (bluetoothColor) {
-        persist_write_int(KEY_BLUETOOTHCOLOR, bluetoothColor->value->int32);
+        storage_write_int(KEY_BLUETOOTHCOLOR, bluetoothColor->value->int32);
     }
 
     Tuple *overrideLocation = dict_find(iterator, KEY_OVERRIDELOCATION);
     if (overrideLocation) {
-        persist_write_string(KEY_OVERRIDELOCATION, overrideLocation->value->cstring);
+        storage_write_string(KEY_OVERRIDELOCATION, overrideLocation->value->cstring);
     }
 
     Tuple *updateAvailable = dict_find(iterator, KEY_UPDATE);
@@ -266,27 +349,27 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
 
     Tuple *updateColor = dict_find(iterator, KEY_UPDATECOLOR);
     if (updateColor) {
-        persist_write_int(KEY_UPDATECOLOR, updateColor->value->int32);
+        storage_write_int(KEY_UPDATECOLOR, updateColor->value->int32);
     }
 
     Tuple *locale = dict_find(iterator, KEY_LOCALE);
     if (locale) {
-        persist_write_int(KEY_LOCALE, locale->value->int8);
+        storage_write_int(KEY_LOCALE, locale->value->int8);
     }
 
     Tuple *dateFormat = dict_find(iterator, KEY_DATEFORMAT);
     if (dateFormat) {
-        persist_write_int(KEY_DATEFORMAT, dateFormat->value->int8);
+        storage_write_int(KEY_DATEFORMAT, dateFormat->value->int8);
     }
 
     Tuple *textAlign = dict_find(iterator, KEY_TEXTALIGN);
     if (textAlign) {
-        persist_write_int(KEY_TEXTALIGN, textAlign->value->int8);
+        storage_write_int(KEY_TEXTALIGN, textAlign->value->int8);
     }
 
     Tuple *speedUnit = dict_find(iterator, KEY_SPEEDUNIT);
     if (speedUnit) {
-        persist_write_int(KEY_SPEEDUNIT, speedUnit->value->int8);
+        storage_write_int(KEY_SPEEDUNIT, speedUnit->value->int8);
     }
 
     Tuple *leadingZero = dict_find(iterator, KEY_LEADINGZERO);
@@ -305,80 +388,160 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
     if (slotA) {
         int value = slotA->value->int8;
         set_module(SLOT_A, value, false);
-        persist_write_int(KEY_SLOTA, value);
+        storage_write_int(KEY_SLOTA, value);
     }
     Tuple *slotB = dict_find(iterator, KEY_SLOTB);
     if (slotB) {
         int value = slotB->value->int8;
         set_module(SLOT_B, value, false);
-        persist_write_int(KEY_SLOTB, value);
+        storage_write_int(KEY_SLOTB, value);
     }
     Tuple *slotC = dict_find(iterator, KEY_SLOTC);
     if (slotC) {
         int value = slotC->value->int8;
         set_module(SLOT_C, value, false);
-        persist_write_int(KEY_SLOTC, value);
+        storage_write_int(KEY_SLOTC, value);
     }
     Tuple *slotD = dict_find(iterator, KEY_SLOTD);
     if (slotD) {
         int value = slotD->value->int8;
         set_module(SLOT_D, value, false);
-        persist_write_int(KEY_SLOTD, value);
+        storage_write_int(KEY_SLOTD, value);
     }
 
     Tuple *slotASleep = dict_find(iterator, KEY_SLEEPSLOTA);
     if (slotASleep) {
         int value = slotASleep->value->int8;
         set_module(SLOT_A, value, true);
-        persist_write_int(KEY_SLEEPSLOTA, value);
+        storage_write_int(KEY_SLEEPSLOTA, value);
     }
     Tuple *slotBSleep = dict_find(iterator, KEY_SLEEPSLOTB);
     if (slotBSleep) {
         int value = slotBSleep->value->int8;
         set_module(SLOT_B, value, true);
-        persist_write_int(KEY_SLEEPSLOTB, value);
+        storage_write_int(KEY_SLEEPSLOTB, value);
     }
     Tuple *slotCSleep = dict_find(iterator, KEY_SLEEPSLOTC);
     if (slotCSleep) {
         int value = slotCSleep->value->int8;
         set_module(SLOT_C, value, true);
-        persist_write_int(KEY_SLEEPSLOTC, value);
+        storage_write_int(KEY_SLEEPSLOTC, value);
     }
     Tuple *slotDSleep = dict_find(iterator, KEY_SLEEPSLOTD);
     if (slotDSleep) {
         int value = slotDSleep->value->int8;
         set_module(SLOT_D, value, true);
-        persist_write_int(KEY_SLEEPSLOTD, value);
+        storage_write_int(KEY_SLEEPSLOTD, value);
     }
 
-    persist_write_int(KEY_CONFIGS, configs);
+    storage_write_int(KEY_CONFIGS, configs);
     set_config_toggles(configs);
-    set_timezone(tz_name, tz_hour, tz_minute);
+    set_world_clock(0, tz_name, tz_hour, tz_minute);
+    process_world_clock(iterator, 1, KEY_TIMEZONES2, KEY_TIMEZONES2MINUTES, KEY_TIMEZONES2CODE);
+    process_world_clock(iterator, 2, KEY_TIMEZONES3, KEY_TIMEZONES3MINUTES, KEY_TIMEZONES3CODE);
+
+    // painted over a different config
+    discard_snapshot();
 
     destroy_text_layers();
     create_text_layers(watchface);
     load_screen(true, watchface);
+
+    memory_phase_end(PHASE_APPLY_CONFIG);
+}
+
+static void inbox_received_callback(DictionaryIterator *iterator, void *context) {
+    energy_count(ENERGY_MESSAGE_IN, dict_size(iterator));
+    uint32_t start = profile_begin();
+    stack_sample_begin();
+    process_inbox(iterator);
+    stack_sample_end(STACK_INBOX);
+    profile_end(PROFILE_INBOX, start);
 }
 
 static void inbox_dropped_callback(AppMessageResult reason, void *context) {
 }
 
+// a failed send has kept the radio busy all the same
 static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
+    energy_count(ENERGY_MESSAGE_OUT, dict_size(iterator));
+    health_log_failed(iterator);
 }
 
 static void outbox_sent_callback(DictionaryIterator *iterator, void *context) {
+    energy_count(ENERGY_MESSAGE_OUT, dict_size(iterator));
+    health_log_sent(iterator);
+}
+
+static void sleep_status_task(void *context) {
+    refresh_sleep_status();
+}
+
+// the weather and health periods follow the profile
+static void power_task(void *context) {
+    update_power_profile(battery_state_service_peek(), is_user_sleeping());
+    count_power_minute();
+    set_task_period(TASK_WEATHER, get_power_profile()->weather_interval * SECONDS_PER_MINUTE);
+    set_task_period(TASK_HEALTH, get_refresh_interval(FAMILY_HEALTH) * SECONDS_PER_MINUTE);
+}
+
+static void update_check_task(void *context) {
+    if (get_power_profile()->update_checks && !is_update_disabled()) {
+        check_for_updates();
+    }
+}
+
+static void sleep_data_task(void *context) {
+    show_sleep_data_if_visible((Window *)context);
+}
+
+static void weather_task(void *context) {
+    if (is_weather_enabled()) {
+        update_weather();
+    }
+    if (is_user_sleeping()) {
+        queue_health_update();
+    }
+}
+
+static void health_task(void *context) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Requesting health from time. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
+    if (!get_power_profile()->health_events) {
+        // nothing else queues an update, the task sets the pace
+        queue_health_update();
+    }
+    get_health_data();
+}
+
+static void schedule_tasks(Window *window) {
+    const struct PowerProfile *power = get_power_profile();
+    time_t now = time(NULL);
+
+    schedule_task(TASK_SLEEP_STATUS, sleep_status_task, NULL, 10 * SECONDS_PER_MINUTE, 0, 0);
+    schedule_task(TASK_POWER, power_task, NULL, SECONDS_PER_MINUTE, 0, 0);
+    schedule_task(TASK_UPDATE_CHECK, update_check_task, NULL, SECONDS_PER_DAY, 4 * SECONDS_PER_HOUR, 0); // at 4:00am
+    schedule_task(TASK_SLEEP_DATA, sleep_data_task, window, SECONDS_PER_MINUTE, 0, 0);
+    // as if the last request was half an hour ago
+    schedule_task_after(TASK_WEATHER, weather_task, NULL, now - now % SECONDS_PER_MINUTE - 30 * SECONDS_PER_MINUTE,
+                        power->weather_interval * SECONDS_PER_MINUTE, 0);
+    schedule_task(TASK_HEALTH, health_task, NULL, get_refresh_interval(FAMILY_HEALTH) * SECONDS_PER_MINUTE, 0, 0);
+    // past the hour, clear of the weather request
+    schedule_task(TASK_HEALTH_LOG, health_log_task, NULL, SECONDS_PER_HOUR, 7 * SECONDS_PER_MINUTE, 0);
 }
 
 static void watchface_load(Window *window) {
     create_text_layers(window);
 
-    min_counter = 30; // after loading, get the next weather update
+    schedule_tasks(window);
 
     load_timezone_from_storage();
 }
 
 static void watchface_unload(Window *window) {
+    save_snapshot();
     save_health_data_to_storage();
+    save_health_log();
+    storage_flush();
 
     unload_face_fonts();
 
@@ -386,36 +549,24 @@ static void watchface_unload(Window *window) {
 }
 
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
+    uint32_t start = profile_begin();
+    uint32_t energy_start = energy_begin();
+    stack_sample_begin();
     update_time();
-    min_counter++;
-
-    if (!is_update_disabled() && tick_time->tm_hour == 4 && tick_time->tm_min == 0) { // updates at 4:00am
-        check_for_updates();
-    }
     if (is_update_disabled()) {
         notify_update(false);
     }
-
-    uint8_t tick_interval = is_user_sleeping() ? 90 : 30;
-
-    show_sleep_data_if_visible(watchface);
-
-    if(min_counter >= tick_interval) {
-        if (is_weather_enabled()) {
-            update_weather();
-        }
-        if (is_user_sleeping()) {
-            queue_health_update();
-        }
-        min_counter = 0;
-    }
-    if (tick_time->tm_min % 2 == 0) { // check for health updates every 2 minutes
-        APP_LOG(APP_LOG_LEVEL_DEBUG, "Requesting health from time. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
-        get_health_data();
-    }
+    run_scheduled_tasks();
+    stack_sample_end(STACK_TICK);
+    energy_end(ENERGY_TICK, energy_start);
+    profile_end(PROFILE_TICK, start);
 }
 
 static void init(void) {
+    memory_phase_begin(PHASE_INIT);
+
+    init_energy();
+
     tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
 
     init_sleep_data();
@@ -432,17 +583,25 @@ static void init(void) {
 
     window_stack_push(watchface, true);
 
+    #if PBL_API_EXISTS(unobstructed_area_service_subscribe)
+    unobstructed_area_service_subscribe((UnobstructedAreaHandlers) {
+        .change = unobstructed_change_handler
+    }, watchface);
+    #endif
+
     app_message_register_inbox_received(inbox_received_callback);
     app_message_register_inbox_dropped(inbox_dropped_callback);
     app_message_register_outbox_failed(outbox_failed_callback);
     app_message_register_outbox_sent(outbox_sent_callback);
-    app_message_open(512, 64);
+    app_message_open(INBOX_SIZE, OUTBOX_SIZE);
 
     connection_service_subscribe((ConnectionHandlers) {
 	.pebble_app_connection_handler = bt_handler
     });
 
-    load_screen(false, watchface);
+    start_screen(watchface);
+
+    memory_phase_end(PHASE_INIT);
 }
 
 static void deinit(void) {
@@ -450,7 +609,9 @@ static void deinit(void) {
 }
 
 int main(void) {
+    init_memory_stats();
     init();
     app_event_loop();
     deinit();
+    return 0;
 }
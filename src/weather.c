@@ -2,65 +2,68 @@
 #include "keys.h"
 #include "text.h"
 #include "configs.h"
+#include "modules.h"
+#include "memory.h"
+#include "storage.h"
 
 static bool weather_enabled;
 static bool use_celsius;
 
-static char* weather_conditions[] = {
-    "\U0000F07B", // 'unknown': 0,
-    "\U0000F00D", // 'clear': 1,
-    "\U0000F00D", // 'sunny': 2,
-    "\U0000F002", // 'partlycloudy': 3,
-    "\U0000F002", // 'mostlycloudy': 4,
-    "\U0000F00C", // 'mostlysunny': 5,
-    "\U0000F002", // 'partlysunny': 6,
-    "\U0000F013", // 'cloudy': 7,
-    "\U0000F019", // 'rain': 8,
-    "\U0000F01B", // 'snow': 9,
-    "\U0000F01D", // 'tstorms': 10,
-    "\U0000F0b5", // 'sleat': 11,
-    "\U0000F00A", // 'flurries': 12,
-    "\U0000F0b6", // 'hazy': 13,
-    "\U0000F01D", // 'chancetstorms': 14,
-    "\U0000F01B", // 'chancesnow': 15,
-    "\U0000F0b5", // 'chancesleat': 16,
-    "\U0000F008", // 'chancerain': 17,
-    "\U0000F01B", // 'chanceflurries': 18,
-    "\U0000F07B", // 'nt_unknown': 19,
-    "\U0000F02E", // 'nt_clear': 20,
-    "\U0000F02E", // 'nt_sunny': 21,
-    "\U0000F086", // 'nt_partlycloudy': 22,
-    "\U0000F086", // 'nt_mostlycloudy': 23,
-    "\U0000F081", // 'nt_mostlysunny': 24,
-    "\U0000F086", // 'nt_partlysunny': 25,
-    "\U0000F013", // 'nt_cloudy': 26,
-    "\U0000F019", // 'nt_rain': 27,
-    "\U0000F01B", // 'nt_snow': 28,
-    "\U0000F01D", // 'nt_tstorms': 29,
-    "\U0000F0b5", // 'nt_sleat': 30,
-    "\U0000F038", // 'nt_flurries': 31,
-    "\U0000F04A", // 'nt_hazy': 32,
-    "\U0000F01D", // 'nt_chancetstorms': 33,
-    "\U0000F038", // 'nt_chancesnow': 34,
-    "\U0000F0B3", // 'nt_chancesleat': 35,
-    "\U0000F036", // 'nt_chancerain': 36,
-    "\U0000F038", // 'nt_chanceflurries': 37,
-    "\U0000F003", // 'fog': 38,
-    "\U0000F04A", // 'nt_fog': 39,
-    "\U0000F04e", // drizzle: 40
-    "\U0000F015", // hail: 41
-    "\U0000F076", // cold: 42
-    "\U0000F072", // hot: 43
-    "\U0000F050", // windy: 44
-    "\U0000F056", // tornado: 45
-    "\U0000F073", // hurricane: 46
+// the weather icon of each condition id the phone sends, as codepoints of
+// the weather font, encoded when shown
+static const uint16_t weather_conditions[] = {
+    0xF07B, // 'unknown': 0,
+    0xF00D, // 'clear': 1,
+    0xF00D, // 'sunny': 2,
+    0xF002, // 'partlycloudy': 3,
+    0xF002, // 'mostlycloudy': 4,
+    0xF00C, // 'mostlysunny': 5,
+    0xF002, // 'partlysunny': 6,
+    0xF013, // 'cloudy': 7,
+    0xF019, // 'rain': 8,
+    0xF01B, // 'snow': 9,
+    0xF01D, // 'tstorms': 10,
+    0xF0B5, // 'sleat': 11,
+    0xF00A, // 'flurries': 12,
+    0xF0B6, // 'hazy': 13,
+    0xF01D, // 'chancetstorms': 14,
+    0xF01B, // 'chancesnow': 15,
+    0xF0B5, // 'chancesleat': 16,
+    0xF008, // 'chancerain': 17,
+    0xF01B, // 'chanceflurries': 18,
+    0xF07B, // 'nt_unknown': 19,
+    0xF02E, // 'nt_clear': 20,
+    0xF02E, // 'nt_sunny': 21,
+    0xF086, // 'nt_partlycloudy': 22,
+    0xF086, // 'nt_mostlycloudy': 23,
+    0xF081, // 'nt_mostlysunny': 24,
+    0xF086, // 'nt_partlysunny': 25,
+    0xF013, // 'nt_cloudy': 26,
+    0xF019, // 'nt_rain': 27,
+    0xF01B, // 'nt_snow': 28,
+    0xF01D, // 'nt_tstorms': 29,
+    0xF0B5, // 'nt_sleat': 30,
+    0xF038, // 'nt_flurries': 31,
+    0xF04A, // 'nt_hazy': 32,
+    0xF01D, // 'nt_chancetstorms': 33,
+    0xF038, // 'nt_chancesnow': 34,
+    0xF0B3, // 'nt_chancesleat': 35,
+    0xF036, // 'nt_chancerain': 36,
+    0xF038, // 'nt_chanceflurries': 37,
+    0xF003, // 'fog': 38,
+    0xF04A, // 'nt_fog': 39,
+    0xF04E, // drizzle: 40
+    0xF015, // hail: 41
+    0xF076, // cold: 42
+    0xF072, // hot: 43
+    0xF050, // windy: 44
+    0xF056, // tornado: 45
+    0xF073, // hurricane: 46
 };
 
-static char* wind_directions[] = {
-    "S", "T", "U", "V", "W", "X", "Y", "Z",
-    "0", "1", "2", "3", "4", "5", "6", "7",
-    "o"
-};
+// the arrow of each compass sector from north, clockwise, pointing where the
+// wind goes
+static const char wind_directions[] = "01234567STUVWXYZ";
 
 void update_weather(void) {
     DictionaryIterator *iter;
@@ -68,42 +71,22 @@ void update_weather(void) {
     app_message_outbox_send();
 }
 
-static char* get_wind_direction(int degrees) {
-    if (degrees > 349 || degrees <= 11) {
-        return wind_directions[8]; // N -> S
-    } else if (degrees > 11 && degrees <= 34) {
-        return wind_directions[9]; // NNE -> SSW
-    } else if (degrees > 34 && degrees <= 56) {
-        return wind_directions[10]; // NE -> SW
-    } else if (degrees > 56 && degrees <= 79) {
-        return wind_directions[11]; // ENE -> WSW
-    } else if (degrees > 79 && degrees <= 101) {
-        return wind_directions[12]; // E -> W
-    } else if (degrees > 101 && degrees <= 124) {
-        return wind_directions[13]; // ESE -> WNW
-    } else if (degrees > 124 && degrees <= 146) {
-        return wind_directions[14]; // SE -> NW
-    } else if (degrees > 146 && degrees <= 169) {
-        return wind_directions[15]; // SSE -> NNW
-    } else if (degrees > 169 && degrees <= 191) {
-        return wind_directions[0]; // S -> N
-    } else if (degrees > 191 && degrees <= 214) {
-        return wind_directions[1]; // SSW -> NNE
-    } else if (degrees > 214 && degrees <= 236) {
-        return wind_directions[2]; // SW -> NE
-    } else if (degrees > 239 && degrees <= 259) {
-        return wind_directions[3]; // WSW -> ENE
-    } else if (degrees > 259 && degrees <= 281) {
-        return wind_directions[4]; // W -> E
-    } else if (degrees > 281 && degrees <= 304) {
-        return wind_directions[5]; // WNW -> ESE
-    } else if (degrees > 304 && degrees <= 326) {
-        return wind_directions[6]; // NW -> SE
-    } else if (degrees > 326 && degrees <= 349) {
-        return wind_directions[7]; // NNW -> SSE
-    }
+// one of 16 sectors of 22.5 degrees, the first centered on north
+static char get_wind_direction(int degrees) {
+    degrees = (degrees % 360 + 360) % 360;
+    return wind_directions[(degrees * 2 + 22) / 45 % 16];
+}
 
-    return wind_directions[16];
+// a codepoint of the weather font (U+F000 to U+F0FF) takes three bytes
+static void encode_weather_icon(int weather_val, char *buffer) {
+    if (weather_val < 0 || weather_val >= (int)ARRAY_LENGTH(weather_conditions)) {
+        weather_val = 0;
+    }
+    uint16_t codepoint = weather_conditions[weather_val];
+    buffer[0] = 0xE0 | codepoint >> 12;
+    buffer[1] = 0x80 | (codepoint >> 6 & 0x3F);
+    buffer[2] = 0x80 | (codepoint & 0x3F);
+    buffer[3] = '\0';
 }
 
 void update_weather_values(int temp_val, int weather_val) {
@@ -119,7 +102,7 @@ void update_weather_values(int temp_val, int weather_val) {
         }
 
         snprintf(temp_text, sizeof(temp_text), temp_pattern, temp_val);
-        snprintf(weather_text, sizeof(weather_text), "%s", weather_conditions[weather_val]);
+        encode_weather_icon(weather_val, weather_text);
 
         set_temp_cur_layer_text(temp_text);
         set_weather_layer_text(weather_text);
@@ -152,10 +135,9 @@ void update_forecast_values(int max_val, int min_val) {
 void update_wind_values(int speed, int direction) {
     if (is_module_enabled(MODULE_WIND)) {
         char wind_speed[4];
-        char wind_dir[2];
-        char *wind_unit;
+        char wind_dir[2] = { get_wind_direction(direction), '\0' };
+        const char *wind_unit;
 
-        strcpy(wind_dir, get_wind_direction(direction));
         if (get_wind_speed_unit() == UNIT_KPH) {
             speed = (speed * 1.60934)/1;
             wind_unit = ")";
@@ -177,15 +159,28 @@ void update_wind_values(int speed, int direction) {
     }
 }
 
+// the update hook of the weather modules, from the last stored values
+void show_weather_module(int module) {
+    switch (module) {
+        case MODULE_WEATHER:
+            update_weather_values(storage_read_int(KEY_TEMP), storage_read_int(KEY_WEATHER));
+            break;
+        case MODULE_FORECAST:
+            update_forecast_values(storage_read_int(KEY_MAX), storage_read_int(KEY_MIN));
+            break;
+        case MODULE_WIND:
+            update_wind_values(storage_read_int(KEY_SPEED), storage_read_int(KEY_DIRECTION));
+            break;
+    }
+}
+
 static bool get_weather_enabled() {
-    bool weather_module_available =
-        is_module_enabled(MODULE_WEATHER) ||
-        is_module_enabled(MODULE_FORECAST) ||
-        is_module_enabled(MODULE_WIND);
-    return is_weather_toggle_enabled() || weather_module_available;
+    return is_weather_toggle_enabled() || is_family_enabled(FAMILY_WEATHER);
 }
 
 void toggle_weather(bool from_configs) {
+    memory_phase_begin(PHASE_TOGGLE_WEATHER);
+
     weather_enabled = get_weather_enabled();
     if (weather_enabled) {
 
@@ -197,19 +192,12 @@ void toggle_weather(bool from_configs) {
             update_forecast_values(0, 0);
             update_wind_values(0, 16);
             update_weather();
-        } else if (persist_exists(KEY_TEMP)) {
+        } else if (storage_exists(KEY_TEMP)) {
             APP_LOG(APP_LOG_LEVEL_DEBUG, "Updating weather from storage. %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
-            int temp = persist_read_int(KEY_TEMP);
-            int weather = persist_read_int(KEY_WEATHER);
-            update_weather_values(temp, weather);
-
-            int min = persist_read_int(KEY_MIN);
-            int max = persist_read_int(KEY_MAX);
-            update_forecast_values(max, min);
-
-            int speed = persist_read_int(KEY_SPEED);
-            int direction = persist_read_int(KEY_DIRECTION);
-            update_wind_values(speed, direction);
+            // all three, the ones not in a slot are cleared
+            show_weather_module(MODULE_WEATHER);
+            show_weather_module(MODULE_FORECAST);
+            show_weather_module(MODULE_WIND);
         } else {
             APP_LOG(APP_LOG_LEVEL_DEBUG, "No weather data from storage. Requesting... %d%03d", (int)time(NULL), (int)time_ms(NULL, NULL));
             update_weather_values(0, 0);
@@ -229,16 +217,18 @@ void toggle_weather(bool from_configs) {
         set_wind_speed_layer_text("");
         set_wind_unit_layer_text("");
     }
+
+    memory_phase_end(PHASE_TOGGLE_WEATHER);
 }
 
 void store_weather_values(int temp, int max, int min, int weather, int speed, int direction) {
     APP_LOG(APP_LOG_LEVEL_DEBUG, "Storing weather data. %d %d%03d", use_celsius, (int)time(NULL), (int)time_ms(NULL, NULL));
-    persist_write_int(KEY_TEMP, temp);
-    persist_write_int(KEY_MAX, max);
-    persist_write_int(KEY_MIN, min);
-    persist_write_int(KEY_WEATHER, weather);
-    persist_write_int(KEY_SPEED, speed);
-    persist_write_int(KEY_DIRECTION, direction);
+    storage_write_int(KEY_TEMP, temp);
+    storage_write_int(KEY_MAX, max);
+    storage_write_int(KEY_MIN, min);
+    storage_write_int(KEY_WEATHER, weather);
+    storage_write_int(KEY_SPEED, speed);
+    storage_write_int(KEY_DIRECTION, direction);
 }
 
 bool is_weather_enabled() {
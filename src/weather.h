@@ -8,5 +8,6 @@ void update_wind_values(int speed, int direction);
 void store_weather_values(int temp_val, int max_val, int min_val, int weather_val, int speed_val, int direction_val);
 void toggle_weather();
 bool is_weather_enabled();
+void show_weather_module(int module);
 
 #endif
@@ -0,0 +1,249 @@
+#!/usr/bin/env python
+"""
+Computes the glyphs each font resource actually needs and writes them as the
+characterRegex of the font entries in package.json.
+
+The glyph set of every font role comes from the sources:
+ * date: the locale names in resources/data/locales.txt and the SEPARATORS
+   string in src/locales.c
+ * weather: the codepoints in the weather_conditions table in src/weather.c
+ * icons: the wind_directions string, the wind unit glyphs and the literals
+   passed to the icon layer setters
+ * base: the literal parts of the snprintf/strcpy format strings used for the
+   small texts, the characters the time formatter writes directly, plus the
+   timezone codes (uppercased, free text)
+ * time: the hour digits and separator
+
+Which resource plays which role is read from the font ids assigned in
+src/text.c.
+
+Usage: python tools/glyphs.py [--check]
+"""
+
+from __future__ import print_function
+
+import collections
+import io
+import json
+import os
+import re
+import sys
+
+import locales as locale_packs
+
+if sys.version_info[0] < 3:
+    chr = unichr  # noqa: F821 (waf runs on python 2)
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+
+DIGITS = set('0123456789')
+UPPERCASE = set('ABCDEFGHIJKLMNOPQRSTUVWXYZ')
+
+# characters produced by printf-style conversions
+CONVERSIONS = {
+    'd': DIGITS | set('-'),
+    'i': DIGITS | set('-'),
+    'u': DIGITS,
+    'H': DIGITS, 'I': DIGITS, 'k': DIGITS, 'l': DIGITS, 'M': DIGITS,
+    'p': set('AMP'),
+    '%': set('%'),
+    's': set(),  # tables referenced through %s are added explicitly
+}
+
+# files whose format strings are rendered with the base font
+BASE_FONT_SOURCES = ['src/health.c', 'src/weather.c', 'src/screen.c', 'src/time.c']
+
+ICON_SETTERS = ['set_bluetooth_layer_text', 'set_update_layer_text',
+                'set_max_icon_layer_text', 'set_min_icon_layer_text']
+
+# universe used to expand the hand written regexes when reporting
+CANDIDATES = [chr(c) for c in range(0x20, 0x7f)] + [chr(c) for c in range(0xf000, 0xf100)]
+
+
+def read(path):
+    with io.open(os.path.join(ROOT, path), encoding='utf-8') as f:
+        return f.read()
+
+
+def strip_comments(source):
+    source = re.sub(r'/\*.*?\*/', '', source, flags=re.S)
+    return re.sub(r'//[^\n]*', '', source)
+
+
+def unescape(literal):
+    literal = re.sub(r'\\U([0-9a-fA-F]{8})', lambda m: chr(int(m.group(1), 16)), literal)
+    literal = re.sub(r'\\u([0-9a-fA-F]{4})', lambda m: chr(int(m.group(1), 16)), literal)
+    return literal.replace('\\"', '"').replace('\\\\', '\\')
+
+
+def literals(source):
+    return [unescape(m) for m in re.findall(r'"((?:[^"\\]|\\.)*)"', source)]
+
+
+def string_table(source, name):
+    """The characters of a table kept as one string, name[] = "..."."""
+    match = re.search(r'\b' + name + r'\[\]\s*=\s*"((?:[^"\\]|\\.)*)";', source)
+    if not match:
+        raise SystemExit('Table {} not found'.format(name))
+    return unescape(match.group(1))
+
+
+def codepoint_table(source, name):
+    match = re.search(r'\b' + name + r'\b[^=]*=\s*\{(.*?)\};', source, flags=re.S)
+    if not match:
+        raise SystemExit('Table {} not found'.format(name))
+    return [chr(int(cp, 16)) for cp in re.findall(r'\b0x([0-9a-fA-F]+)\b', strip_comments(match.group(1)))]
+
+
+def char_literals(source):
+    return [unescape(m) for m in re.findall(r"'((?:[^'\\]|\\.))'", source)]
+
+
+def format_glyphs(fmt):
+    glyphs = set()
+    i = 0
+    while i < len(fmt):
+        if fmt[i] == '%':
+            spec = re.match(r'%[-+ #0]*\d*(?:\.\d+)?(.)', fmt[i:])
+            if spec:
+                glyphs |= CONVERSIONS.get(spec.group(1), set())
+                i += len(spec.group(0))
+                continue
+        glyphs.add(fmt[i])
+        i += 1
+    return glyphs
+
+
+def call_literals(source, functions):
+    pattern = r'\b(?:' + '|'.join(functions) + r')\s*\(([^;]*)\);'
+    found = []
+    for args in re.findall(pattern, source):
+        found.extend(literals(args))
+    return found
+
+
+def compute_roles():
+    locales = strip_comments(read('src/locales.c'))
+    weather = strip_comments(read('src/weather.c'))
+
+    roles = collections.OrderedDict()
+
+    roles['time'] = DIGITS | set(':')
+
+    date = DIGITS.copy()
+    for code, names in locale_packs.read_table():
+        date |= set(''.join(names))
+    date |= set(string_table(locales, 'SEPARATORS'))
+    roles['medium'] = date
+
+    base = UPPERCASE | DIGITS | set('+- ')
+    for path in BASE_FONT_SOURCES:
+        source = strip_comments(read(path))
+        for fmt in call_literals(source, ['snprintf', 'strftime', 'strcpy', 'strcat']):
+            base |= format_glyphs(fmt)
+        base |= set(c for c in char_literals(source) if len(c) == 1 and c >= ' ')
+    roles['base'] = base
+
+    roles['weather'] = set(codepoint_table(weather, 'weather_conditions'))
+
+    icons = set(string_table(weather, 'wind_directions'))
+    icons |= set(''.join(re.findall(r'wind_unit\s*=\s*"([^"]*)"', weather)))
+    for path in ('src/screen.c', 'src/weather.c', 'src/health.c', 'src/timeboxed.c'):
+        icons |= set(''.join(call_literals(strip_comments(read(path)), ICON_SETTERS)))
+    roles['custom'] = icons
+
+    return roles
+
+
+def font_roles():
+    text = strip_comments(read('src/text.c'))
+    assignments = re.findall(r'\b(time|medium|base|weather|custom)_(?:font_)?id\s*=\s*'
+                             r'(?:[^;?]*\?\s*)?RESOURCE_ID_(\w+)', text)
+    return dict((name, role) for role, name in assignments)
+
+
+def to_regex(glyphs):
+    codepoints = sorted(ord(g) for g in glyphs)
+    ranges = []
+    for cp in codepoints:
+        if ranges and ranges[-1][1] == cp - 1:
+            ranges[-1][1] = cp
+        else:
+            ranges.append([cp, cp])
+
+    def escape(cp):
+        c = chr(cp)
+        return '\\' + c if c in '\\]^-[' else c
+
+    parts = []
+    for first, last in ranges:
+        if last - first >= 2:
+            parts.append(escape(first) + '-' + escape(last))
+        else:
+            parts.extend(escape(cp) for cp in range(first, last + 1))
+    return '[' + ''.join(parts) + ']'
+
+
+def expand_regex(regex):
+    pattern = re.compile(regex)
+    return set(c for c in CANDIDATES if pattern.match(c))
+
+
+def estimate_size(name, count):
+    # Pebble bitmap fonts: a glyph header plus a 1bpp bitmap of roughly
+    # 0.6em x 1em, and a 4 byte offset table entry
+    size = int(re.search(r'(\d+)$', name).group(1))
+    return count * (4 + 8 + (int(size * 0.6) * size + 7) // 8)
+
+
+def main(argv):
+    check = '--check' in argv
+    path = os.path.join(ROOT, 'package.json')
+    with io.open(path, encoding='utf-8') as f:
+        package = json.load(f, object_pairs_hook=collections.OrderedDict)
+
+    roles = compute_roles()
+    assignments = font_roles()
+    stale = False
+    total_before = 0
+    total_after = 0
+
+    print('{:<20} {:>13} {:>17}  {}'.format('font', 'glyphs', 'estimated bytes', 'previously missing'))
+    for media in package['pebble']['resources']['media']:
+        if media.get('type') != 'font' or media['name'] not in assignments:
+            continue
+        glyphs = roles[assignments[media['name']]]
+        regex = to_regex(glyphs)
+        before = expand_regex(media['characterRegex'])
+        missing = sorted(glyphs - before)
+
+        size_before = estimate_size(media['name'], len(before))
+        size_after = estimate_size(media['name'], len(glyphs))
+        total_before += size_before
+        total_after += size_after
+
+        print(u'{:<20} {:>6} -> {:<4} {:>7} -> {:<7}  {}'.format(
+            media['name'], len(before), len(glyphs), size_before, size_after,
+            ''.join(missing).encode('unicode_escape').decode('ascii')))
+
+        if media['characterRegex'] != regex:
+            stale = True
+            media['characterRegex'] = regex
+
+    print('Estimated font resources: {} bytes -> {} bytes'.format(total_before, total_after))
+
+    if check:
+        if stale:
+            print('package.json glyph regexes are out of date, run tools/glyphs.py')
+        return 1 if stale else 0
+
+    if stale:
+        output = json.dumps(package, indent=2, separators=(',', ': ')) + '\n'
+        with io.open(path, 'w', encoding='utf-8') as f:
+            f.write(output if isinstance(output, type(u'')) else output.decode('utf-8'))
+        print('Updated font glyphs in package.json')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
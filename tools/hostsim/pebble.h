@@ -0,0 +1,454 @@
+// Host stand-in for the parts of the Pebble SDK the face uses. It is enough
+// to compile src/*.c with a regular C compiler and drive the face from
+// sim.c; behaviour is emulated in pebble_stub.c.
+#ifndef __HOSTSIM_PEBBLE_
+#define __HOSTSIM_PEBBLE_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "resource_ids.auto.h"
+
+#if defined(PBL_PLATFORM_APLITE)
+#define PBL_BW
+#define PBL_RECT
+#define PBL_SDK_3
+#elif defined(PBL_PLATFORM_BASALT)
+#define PBL_COLOR
+#define PBL_RECT
+#define PBL_HEALTH
+#define PBL_SDK_4
+#elif defined(PBL_PLATFORM_CHALK)
+#define PBL_COLOR
+#define PBL_ROUND
+#define PBL_HEALTH
+#define PBL_SDK_4
+#else
+#error "Define PBL_PLATFORM_APLITE, PBL_PLATFORM_BASALT or PBL_PLATFORM_CHALK"
+#endif
+
+#if defined(PBL_ROUND)
+#define PBL_IF_ROUND_ELSE(if_true, if_false) (if_true)
+#define PBL_IF_RECT_ELSE(if_true, if_false) (if_false)
+#define SIM_SCREEN_WIDTH 180
+#define SIM_SCREEN_HEIGHT 180
+#else
+#define PBL_IF_ROUND_ELSE(if_true, if_false) (if_false)
+#define PBL_IF_RECT_ELSE(if_true, if_false) (if_true)
+#define SIM_SCREEN_WIDTH 144
+#define SIM_SCREEN_HEIGHT 168
+#endif
+
+#if defined(PBL_COLOR)
+#define PBL_IF_COLOR_ELSE(if_true, if_false) (if_true)
+#else
+#define PBL_IF_COLOR_ELSE(if_true, if_false) (if_false)
+#endif
+
+#if defined(PBL_SDK_4)
+#define PBL_API_EXISTS(api) 1
+#else
+#define PBL_API_EXISTS(api) 0
+#endif
+
+#define ARRAY_LENGTH(array) (sizeof((array))/sizeof((array)[0]))
+
+#define SECONDS_PER_MINUTE 60
+#define MINUTES_PER_HOUR 60
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_DAY 86400
+#define TZ_LEN 6 // as in the SDK, the face sizes its codes with TZ_NAME_LEN
+
+// Logging
+
+typedef enum {
+    APP_LOG_LEVEL_ERROR = 1,
+    APP_LOG_LEVEL_WARNING = 50,
+    APP_LOG_LEVEL_INFO = 100,
+    APP_LOG_LEVEL_DEBUG = 200,
+    APP_LOG_LEVEL_DEBUG_VERBOSE = 255,
+} AppLogLevel;
+
+void app_log(uint8_t log_level, const char* src_filename, int src_line_number, const char* fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+#define APP_LOG(level, fmt, args...) app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+// Counted replacements for the calls the benchmark reports on
+
+int sim_snprintf(char *str, size_t size, const char *format, ...) __attribute__((format(printf, 3, 4)));
+#define snprintf sim_snprintf
+
+time_t sim_time(time_t *tloc);
+#define time(tloc) sim_time(tloc)
+
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms);
+time_t time_start_of_today(void);
+bool clock_is_24h_style(void);
+
+// Graphics types
+
+typedef struct GPoint {
+    int16_t x;
+    int16_t y;
+} GPoint;
+#define GPoint(x, y) ((GPoint){(x), (y)})
+
+typedef struct GSize {
+    int16_t w;
+    int16_t h;
+} GSize;
+#define GSize(w, h) ((GSize){(w), (h)})
+
+typedef struct GRect {
+    GPoint origin;
+    GSize size;
+} GRect;
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GRectZero GRect(0, 0, 0, 0)
+bool grect_equal(const GRect *const rect_a, const GRect *const rect_b);
+
+typedef union GColor8 {
+    uint8_t argb;
+    struct {
+        uint8_t b:2;
+        uint8_t g:2;
+        uint8_t r:2;
+        uint8_t a:2;
+    };
+} GColor8;
+typedef GColor8 GColor;
+
+#define GColorFromRGBA(red, green, blue, alpha) ((GColor8){ \
+    .a = (uint8_t)(alpha) >> 6, .r = (uint8_t)(red) >> 6, .g = (uint8_t)(green) >> 6, .b = (uint8_t)(blue) >> 6})
+#define GColorFromRGB(red, green, blue) GColorFromRGBA(red, green, blue, 255)
+#define GColorFromHEX(v) GColorFromRGB(((v) >> 16) & 0xff, ((v) >> 8) & 0xff, ((v) & 0xff))
+#define GColorClear ((GColor8){.argb = 0x00})
+#define GColorBlack ((GColor8){.argb = 0xC0})
+#define GColorWhite ((GColor8){.argb = 0xFF})
+#define GColorClearARGB8 0x00
+bool gcolor_equal(GColor8 x, GColor8 y);
+
+typedef enum {
+    GTextAlignmentLeft,
+    GTextAlignmentCenter,
+    GTextAlignmentRight,
+} GTextAlignment;
+
+typedef struct GContext GContext;
+typedef struct SimFont *GFont;
+
+#define FONT_KEY_ROBOTO_BOLD_SUBSET_49 "RESOURCE_ID_ROBOTO_BOLD_SUBSET_49"
+#define FONT_KEY_GOTHIC_28_BOLD "RESOURCE_ID_GOTHIC_28_BOLD"
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+#define FONT_KEY_GOTHIC_14 "RESOURCE_ID_GOTHIC_14"
+
+GFont fonts_get_system_font(const char *font_key);
+
+// Resources
+
+typedef struct SimResource *ResHandle;
+ResHandle resource_get_handle(uint32_t resource_id);
+size_t resource_size(ResHandle h);
+size_t resource_load(ResHandle h, uint8_t *buffer, size_t max_length);
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer, size_t num_bytes);
+GFont fonts_load_custom_font(ResHandle handle);
+void fonts_unload_custom_font(GFont font);
+
+// Layers and windows
+
+typedef struct Layer Layer;
+typedef struct TextLayer TextLayer;
+typedef struct Window Window;
+
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+typedef void (*WindowHandler)(Window *window);
+
+typedef struct WindowHandlers {
+    WindowHandler load;
+    WindowHandler appear;
+    WindowHandler disappear;
+    WindowHandler unload;
+} WindowHandlers;
+
+Layer *layer_create(GRect frame);
+void layer_destroy(Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_mark_dirty(Layer *layer);
+void layer_add_child(Layer *parent, Layer *child);
+void layer_remove_from_parent(Layer *child);
+GRect layer_get_frame(const Layer *layer);
+void layer_set_frame(Layer *layer, GRect frame);
+GRect layer_get_bounds(const Layer *layer);
+void layer_set_hidden(Layer *layer, bool hidden);
+bool layer_get_hidden(const Layer *layer);
+GRect layer_get_unobstructed_bounds(const Layer *layer);
+
+TextLayer *text_layer_create(GRect frame);
+void text_layer_destroy(TextLayer *text_layer);
+Layer *text_layer_get_layer(TextLayer *text_layer);
+void text_layer_set_text(TextLayer *text_layer, const char *text);
+const char *text_layer_get_text(TextLayer *text_layer);
+void text_layer_set_font(TextLayer *text_layer, GFont font);
+void text_layer_set_text_color(TextLayer *text_layer, GColor color);
+void text_layer_set_background_color(TextLayer *text_layer, GColor color);
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment);
+
+Window *window_create(void);
+void window_destroy(Window *window);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+void window_set_background_color(Window *window, GColor background_color);
+Layer *window_get_root_layer(const Window *window);
+void window_stack_push(Window *window, bool animated);
+
+// Storage
+
+#define PERSIST_DATA_MAX_LENGTH 256
+#define PERSIST_STRING_MAX_LENGTH PERSIST_DATA_MAX_LENGTH
+#define E_DOES_NOT_EXIST -4
+
+bool persist_exists(const uint32_t key);
+int persist_get_size(const uint32_t key);
+int32_t persist_read_int(const uint32_t key);
+bool persist_read_bool(const uint32_t key);
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size);
+int persist_read_string(const uint32_t key, char *buffer, const size_t buffer_size);
+int persist_write_int(const uint32_t key, const int32_t value);
+int persist_write_bool(const uint32_t key, const bool value);
+int persist_write_data(const uint32_t key, const void *data, const size_t size);
+int persist_write_string(const uint32_t key, const char *cstring);
+int persist_delete(const uint32_t key);
+
+// Memory
+
+size_t heap_bytes_used(void);
+size_t heap_bytes_free(void);
+
+// Event services
+
+typedef enum {
+    SECOND_UNIT = 1 << 0,
+    MINUTE_UNIT = 1 << 1,
+    HOUR_UNIT = 1 << 2,
+    DAY_UNIT = 1 << 3,
+    MONTH_UNIT = 1 << 4,
+    YEAR_UNIT = 1 << 5,
+} TimeUnits;
+
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+
+typedef struct {
+    uint8_t charge_percent;
+    bool is_charging;
+    bool is_plugged;
+} BatteryChargeState;
+
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+BatteryChargeState battery_state_service_peek(void);
+
+typedef void (*ConnectionHandler)(bool connected);
+typedef struct ConnectionHandlers {
+    ConnectionHandler pebble_app_connection_handler;
+    ConnectionHandler pebblekit_connection_handler;
+} ConnectionHandlers;
+void connection_service_subscribe(ConnectionHandlers conn_handlers);
+void connection_service_unsubscribe(void);
+bool connection_service_peek_pebble_app_connection(void);
+
+void vibes_short_pulse(void);
+void vibes_long_pulse(void);
+void vibes_double_pulse(void);
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data);
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer *timer_handle);
+
+typedef uint32_t AnimationProgress;
+#define ANIMATION_NORMALIZED_MAX 65535
+
+typedef void (*UnobstructedAreaWillChangeHandler)(GRect final_unobstructed_screen_area, void *context);
+typedef void (*UnobstructedAreaChangeHandler)(AnimationProgress progress, void *context);
+typedef void (*UnobstructedAreaDidChangeHandler)(void *context);
+typedef struct UnobstructedAreaHandlers {
+    UnobstructedAreaWillChangeHandler will_change;
+    UnobstructedAreaChangeHandler change;
+    UnobstructedAreaDidChangeHandler did_change;
+} UnobstructedAreaHandlers;
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers, void *context);
+void unobstructed_area_service_unsubscribe(void);
+
+void app_event_loop(void);
+
+// AppMessage
+
+typedef enum {
+    TUPLE_BYTE_ARRAY = 0,
+    TUPLE_CSTRING = 1,
+    TUPLE_UINT = 2,
+    TUPLE_INT = 3,
+} TupleType;
+
+typedef struct __attribute__((__packed__)) Tuple {
+    uint32_t key;
+    TupleType type:8;
+    uint16_t length;
+    union {
+        uint8_t data[0];
+        char cstring[0];
+        uint8_t uint8;
+        uint16_t uint16;
+        uint32_t uint32;
+        int8_t int8;
+        int16_t int16;
+        int32_t int32;
+    } value[];
+} Tuple;
+
+typedef struct DictionaryIterator DictionaryIterator;
+
+typedef enum {
+    APP_MSG_OK = 0,
+    APP_MSG_SEND_TIMEOUT = 1 << 1,
+    APP_MSG_SEND_REJECTED = 1 << 2,
+    APP_MSG_NOT_CONNECTED = 1 << 3,
+    APP_MSG_APP_NOT_RUNNING = 1 << 4,
+    APP_MSG_INVALID_ARGS = 1 << 5,
+    APP_MSG_BUSY = 1 << 6,
+    APP_MSG_BUFFER_OVERFLOW = 1 << 7,
+    APP_MSG_OUT_OF_MEMORY = 1 << 12,
+} AppMessageResult;
+
+typedef enum {
+    DICT_OK = 0,
+    DICT_NOT_ENOUGH_STORAGE = 1 << 1,
+    DICT_INVALID_ARGS = 1 << 2,
+} DictionaryResult;
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void *context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator *iterator, AppMessageResult reason, void *context);
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback);
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback);
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback);
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator);
+AppMessageResult app_message_outbox_send(void);
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key);
+uint32_t dict_size(DictionaryIterator *iter);
+Tuple *dict_read_first(DictionaryIterator *iter);
+Tuple *dict_read_next(DictionaryIterator *iter);
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t *data, const uint16_t size);
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char *cstring);
+DictionaryResult dict_write_int(DictionaryIterator *iter, const uint32_t key, const void *integer, const uint8_t width_bytes, const bool is_signed);
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value);
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value);
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value);
+DictionaryResult dict_write_int8(DictionaryIterator *iter, const uint32_t key, const int8_t value);
+DictionaryResult dict_write_int16(DictionaryIterator *iter, const uint32_t key, const int16_t value);
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value);
+
+// Health
+
+#if defined(PBL_HEALTH)
+typedef enum {
+    HealthMetricStepCount,
+    HealthMetricActiveSeconds,
+    HealthMetricWalkedDistanceMeters,
+    HealthMetricSleepSeconds,
+    HealthMetricSleepRestfulSeconds,
+    HealthMetricRestingKCalories,
+    HealthMetricActiveKCalories,
+    HealthMetricHeartRateBPM,
+} HealthMetric;
+
+typedef int32_t HealthValue;
+
+typedef enum {
+    HealthServiceAccessibilityMaskAvailable = 1 << 0,
+    HealthServiceAccessibilityMaskNoPermission = 1 << 1,
+    HealthServiceAccessibilityMaskNotSupported = 1 << 2,
+    HealthServiceAccessibilityMaskNotAvailable = 1 << 3,
+} HealthServiceAccessibilityMask;
+
+typedef enum {
+    HealthServiceTimeScopeOnce,
+    HealthServiceTimeScopeWeekly,
+    HealthServiceTimeScopeDailyWeekdayOrWeekend,
+    HealthServiceTimeScopeDaily,
+} HealthServiceTimeScope;
+
+typedef enum {
+    HealthEventSignificantUpdate = 0,
+    HealthEventMovementUpdate,
+    HealthEventSleepUpdate,
+    HealthEventMetricAlert,
+    HealthEventHeartRateUpdate,
+} HealthEventType;
+
+typedef enum {
+    HealthActivityNone = 0,
+    HealthActivitySleep = 1 << 0,
+    HealthActivityRestfulSleep = 1 << 1,
+    HealthActivityWalk = 1 << 2,
+    HealthActivityRun = 1 << 3,
+    HealthActivityOpenWorkout = 1 << 4,
+} HealthActivity;
+typedef uint32_t HealthActivityMask;
+
+typedef enum {
+    MeasurementSystemUnknown,
+    MeasurementSystemMetric,
+    MeasurementSystemImperial,
+} MeasurementSystem;
+
+typedef void (*HealthEventHandler)(HealthEventType event, void *context);
+
+HealthValue health_service_sum(HealthMetric metric, time_t time_start, time_t time_end);
+HealthValue health_service_sum_today(HealthMetric metric);
+HealthValue health_service_sum_averaged(HealthMetric metric, time_t time_start, time_t time_end, HealthServiceTimeScope scope);
+HealthServiceAccessibilityMask health_service_metric_accessible(HealthMetric metric, time_t time_start, time_t time_end);
+HealthServiceAccessibilityMask health_service_metric_averaged_accessible(HealthMetric metric, time_t time_start, time_t time_end, HealthServiceTimeScope scope);
+HealthActivityMask health_service_peek_current_activities(void);
+bool health_service_events_subscribe(HealthEventHandler handler, void *context);
+bool health_service_events_unsubscribe(void);
+MeasurementSystem health_service_get_measurement_system_for_display(HealthMetric metric);
+#endif
+
+// Data logging
+
+typedef enum {
+    DATA_LOGGING_BYTE_ARRAY = 0,
+    DATA_LOGGING_UINT = 2,
+    DATA_LOGGING_INT = 3,
+} DataLoggingItemType;
+
+typedef enum {
+    DATA_LOGGING_SUCCESS = 0,
+    DATA_LOGGING_BUSY,
+    DATA_LOGGING_FULL,
+    DATA_LOGGING_NOT_FOUND,
+    DATA_LOGGING_CLOSED,
+    DATA_LOGGING_INVALID_PARAMS,
+    DATA_LOGGING_INTERNAL_ERR,
+} DataLoggingResult;
+
+typedef void *DataLoggingSessionRef;
+DataLoggingSessionRef data_logging_create(uint32_t tag, DataLoggingItemType item_type, uint16_t item_length, bool resume);
+DataLoggingResult data_logging_log(DataLoggingSessionRef logging_session, const void *data, uint32_t num_items);
+void data_logging_finish(DataLoggingSessionRef logging_session);
+
+#endif
@@ -0,0 +1,1465 @@
+// Emulation of the Pebble SDK calls the face makes, on top of a virtual
+// clock. Everything the benchmark reports on is counted here.
+#include <pebble.h>
+#include <stdarg.h>
+#include "png.h"
+#include "sim.h"
+
+#undef snprintf
+#undef time
+
+SimCounters sim_counters;
+bool sim_verbose;
+bool sim_trace_frames;
+
+static uint64_t now_ms;
+
+// The face's code takes no virtual time, except for the calls below, which
+// cost about what they take on the watch. That is enough for a busy minute
+// to run past the scheduler's budget.
+#define HEALTH_QUERY_MS 6
+#define OUTBOX_SEND_MS 8
+
+static void spend_ms(uint32_t ms) {
+    now_ms += ms;
+}
+
+uint64_t sim_now_ms() {
+    return now_ms;
+}
+
+void sim_set_clock(time_t start) {
+    now_ms = (uint64_t)start * 1000;
+}
+
+time_t sim_time(time_t *tloc) {
+    time_t now = (time_t)(now_ms / 1000);
+    if (tloc) {
+        *tloc = now;
+    }
+    return now;
+}
+
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms) {
+    uint16_t ms = now_ms % 1000;
+    if (t_utc) {
+        *t_utc = sim_time(NULL);
+    }
+    if (out_ms) {
+        *out_ms = ms;
+    }
+    return ms;
+}
+
+time_t time_start_of_today(void) {
+    time_t now = sim_time(NULL);
+    struct tm *local = localtime(&now);
+    local->tm_hour = 0;
+    local->tm_min = 0;
+    local->tm_sec = 0;
+    return mktime(local);
+}
+
+bool clock_is_24h_style(void) {
+    return true;
+}
+
+void app_log(uint8_t log_level, const char* src_filename, int src_line_number, const char* fmt, ...) {
+    sim_counters.logs++;
+    if (!sim_verbose) {
+        return;
+    }
+    time_t now = sim_time(NULL);
+    char stamp[20];
+    strftime(stamp, sizeof(stamp), "%a %H:%M:%S", gmtime(&now));
+    fprintf(stderr, "[%s] %s:%d ", stamp, src_filename, src_line_number);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+int sim_snprintf(char *str, size_t size, const char *format, ...) {
+    sim_counters.snprintf_calls++;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(str, size, format, args);
+    va_end(args);
+    return written;
+}
+
+bool gcolor_equal(GColor8 x, GColor8 y) {
+    return x.argb == y.argb;
+}
+
+// Memory accounting, only for what the stubs allocate themselves
+
+static size_t heap_used;
+
+#define SIM_HEAP_SIZE (PBL_IF_COLOR_ELSE(64, 24) * 1024)
+
+static void *sim_alloc(size_t size) {
+    heap_used += size;
+    return calloc(1, size);
+}
+
+static void sim_free(void *ptr, size_t size) {
+    if (ptr) {
+        heap_used -= size;
+        free(ptr);
+    }
+}
+
+size_t heap_bytes_used(void) {
+    return heap_used;
+}
+
+size_t heap_bytes_free(void) {
+    return SIM_HEAP_SIZE - heap_used;
+}
+
+// Fonts and resources
+
+struct SimFont {
+    uint32_t resource_id;
+};
+
+// how fontgen renders a glyph of a custom font, see resource_ids.py; the
+// system fonts aren't in the resources and have none
+struct SimGlyph {
+    int8_t top; // ink from the top of the line, none when bottom isn't below
+    int8_t bottom;
+    int8_t left; // ink from the pen
+    int8_t right;
+    uint8_t advance;
+};
+
+struct SimSymbol {
+    uint32_t resource_id;
+    uint32_t code;
+    struct SimGlyph glyph;
+};
+
+struct SimResource {
+    uint32_t resource_id;
+};
+
+static const char *resource_files[SIM_RESOURCE_COUNT] = SIM_RESOURCE_FILES;
+static struct SimResource resources[SIM_RESOURCE_COUNT];
+static const struct SimGlyph resource_glyphs[SIM_RESOURCE_COUNT][SIM_FONT_GLYPHS] = SIM_RESOURCE_GLYPHS;
+static const struct SimSymbol resource_symbols[SIM_SYMBOL_COUNT] = SIM_RESOURCE_SYMBOLS;
+static struct SimFont system_font;
+
+GFont fonts_get_system_font(const char *font_key) {
+    return &system_font;
+}
+
+static struct SimGlyph font_glyph(GFont font, uint32_t code) {
+    if (code >= SIM_FIRST_GLYPH && code < SIM_FIRST_GLYPH + SIM_FONT_GLYPHS) {
+        return resource_glyphs[font->resource_id][code - SIM_FIRST_GLYPH];
+    }
+    for (int i = 0; i < SIM_SYMBOL_COUNT; ++i) {
+        if (resource_symbols[i].resource_id == font->resource_id && resource_symbols[i].code == code) {
+            return resource_symbols[i].glyph;
+        }
+    }
+    return (struct SimGlyph) { 0 };
+}
+
+// the code of the UTF-8 character at text, moving past it
+static uint32_t next_code(const char **text) {
+    const uint8_t *c = (const uint8_t *)*text;
+    uint32_t code = *c++;
+    if (code >= 0xc0) {
+        int more = code >= 0xf0 ? 3 : code >= 0xe0 ? 2 : 1;
+        code &= 0x1f >> (more - 1);
+        while (more-- && (*c & 0xc0) == 0x80) {
+            code = code << 6 | (*c++ & 0x3f);
+        }
+    }
+    *text = (const char *)c;
+    return code;
+}
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+    if (resource_id == 0 || resource_id >= SIM_RESOURCE_COUNT) {
+        return NULL;
+    }
+    resources[resource_id].resource_id = resource_id;
+    return &resources[resource_id];
+}
+
+static FILE *open_resource(ResHandle h) {
+    char path[256];
+    if (!h) {
+        return NULL;
+    }
+    snprintf(path, sizeof(path), "%s/%s", SIM_ROOT, resource_files[h->resource_id]);
+    return fopen(path, "rb");
+}
+
+size_t resource_size(ResHandle h) {
+    FILE *f = open_resource(h);
+    if (!f) {
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer, size_t num_bytes) {
+    FILE *f = open_resource(h);
+    if (!f) {
+        return 0;
+    }
+    size_t read = 0;
+    if (fseek(f, start_offset, SEEK_SET) == 0) {
+        read = fread(buffer, 1, num_bytes, f);
+    }
+    fclose(f);
+    return read;
+}
+
+size_t resource_load(ResHandle h, uint8_t *buffer, size_t max_length) {
+    return resource_load_byte_range(h, 0, buffer, max_length);
+}
+
+GFont fonts_load_custom_font(ResHandle handle) {
+    if (!handle) {
+        return NULL;
+    }
+    sim_counters.font_loads++;
+    GFont font = sim_alloc(sizeof(struct SimFont));
+    font->resource_id = handle->resource_id;
+    return font;
+}
+
+void fonts_unload_custom_font(GFont font) {
+    sim_free(font, sizeof(struct SimFont));
+}
+
+// Layers
+
+struct Layer {
+    GRect frame;
+    GRect bounds;
+    bool hidden;
+    const TextLayer *text_layer;
+    LayerUpdateProc update_proc;
+    Layer *parent;
+    Layer *first_child;
+    Layer *next_sibling;
+};
+
+struct TextLayer {
+    Layer layer;
+    const char *text;
+    GFont font;
+    GColor text_color;
+    GColor background_color;
+    GTextAlignment alignment;
+};
+
+struct Window {
+    Layer root;
+    WindowHandlers handlers;
+    GColor background_color;
+    bool loaded;
+};
+
+struct GContext {
+    uint32_t layers_drawn;
+};
+
+static bool screen_dirty;
+static Window *top_window;
+
+// Screen accounting. Marking a layer dirty invalidates its frame on screen,
+// moving it the old frame as well. A frame repaints the whole tree, like the
+// firmware: every visible layer paints its frame clipped to its parent, text
+// layers included since the glyphs may reach anywhere in it. Only pixels of
+// the display count, a circle on chalk.
+#define SCREEN_PIXELS (SIM_SCREEN_WIDTH * SIM_SCREEN_HEIGHT)
+#define TRACE_RECTS 16
+
+static uint8_t frame_dirty[SCREEN_PIXELS];
+static uint8_t frame_painted[SCREEN_PIXELS];
+static GRect frame_rects[TRACE_RECTS];
+static int frame_rect_count;
+
+static uint32_t dirty_heat[SCREEN_PIXELS];
+static uint32_t painted_heat[SCREEN_PIXELS];
+static uint32_t screen_frames;
+static uint64_t screen_dirty_pixels;
+static uint64_t screen_painted_pixels;
+static uint8_t peak_overdraw;
+
+static bool on_display(int x, int y) {
+    #if defined(PBL_ROUND)
+    int dx = 2 * x + 1 - SIM_SCREEN_WIDTH;
+    int dy = 2 * y + 1 - SIM_SCREEN_HEIGHT;
+    return dx * dx + dy * dy <= SIM_SCREEN_WIDTH * SIM_SCREEN_WIDTH;
+    #else
+    return true;
+    #endif
+}
+
+static GRect clip_rect(GRect rect, GRect clip) {
+    int16_t left = rect.origin.x > clip.origin.x ? rect.origin.x : clip.origin.x;
+    int16_t top = rect.origin.y > clip.origin.y ? rect.origin.y : clip.origin.y;
+    int16_t right = rect.origin.x + rect.size.w < clip.origin.x + clip.size.w ?
+        rect.origin.x + rect.size.w : clip.origin.x + clip.size.w;
+    int16_t bottom = rect.origin.y + rect.size.h < clip.origin.y + clip.size.h ?
+        rect.origin.y + rect.size.h : clip.origin.y + clip.size.h;
+    if (right <= left || bottom <= top) {
+        return GRect(left, top, 0, 0);
+    }
+    return GRect(left, top, right - left, bottom - top);
+}
+
+// the frame in screen coordinates, false when the layer isn't in the tree
+// of the top window
+static bool screen_frame(const Layer *layer, GRect *frame) {
+    *frame = layer->frame;
+    while (layer->parent) {
+        layer = layer->parent;
+        frame->origin.x += layer->frame.origin.x;
+        frame->origin.y += layer->frame.origin.y;
+    }
+    return top_window && layer == &top_window->root;
+}
+
+static void invalidate_frame(const Layer *layer) {
+    GRect frame;
+    if (!screen_frame(layer, &frame)) {
+        return;
+    }
+    frame = clip_rect(frame, GRect(0, 0, SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT));
+    if (frame.size.w == 0) {
+        return;
+    }
+    for (int y = frame.origin.y; y < frame.origin.y + frame.size.h; ++y) {
+        memset(&frame_dirty[y * SIM_SCREEN_WIDTH + frame.origin.x], 1, frame.size.w);
+    }
+    for (int i = 0; i < frame_rect_count; ++i) {
+        if (grect_equal(&frame_rects[i], &frame)) {
+            return;
+        }
+    }
+    if (frame_rect_count < TRACE_RECTS) {
+        frame_rects[frame_rect_count++] = frame;
+    }
+}
+
+static void layer_init(Layer *layer, GRect frame) {
+    layer->frame = frame;
+    layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+}
+
+Layer *layer_create(GRect frame) {
+    Layer *layer = sim_alloc(sizeof(Layer));
+    layer_init(layer, frame);
+    return layer;
+}
+
+void layer_destroy(Layer *layer) {
+    if (layer) {
+        layer_remove_from_parent(layer);
+        sim_free(layer, sizeof(Layer));
+    }
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+    layer->update_proc = update_proc;
+}
+
+void layer_mark_dirty(Layer *layer) {
+    sim_counters.invalidations++;
+    screen_dirty = true;
+    invalidate_frame(layer);
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+    layer_remove_from_parent(child);
+    child->parent = parent;
+    Layer **link = &parent->first_child;
+    while (*link) {
+        link = &(*link)->next_sibling;
+    }
+    *link = child;
+    layer_mark_dirty(parent);
+}
+
+void layer_remove_from_parent(Layer *child) {
+    if (!child->parent) {
+        return;
+    }
+    Layer **link = &child->parent->first_child;
+    while (*link && *link != child) {
+        link = &(*link)->next_sibling;
+    }
+    if (*link) {
+        *link = child->next_sibling;
+    }
+    layer_mark_dirty(child->parent);
+    child->parent = NULL;
+    child->next_sibling = NULL;
+}
+
+bool grect_equal(const GRect *const rect_a, const GRect *const rect_b) {
+    return rect_a->origin.x == rect_b->origin.x && rect_a->origin.y == rect_b->origin.y &&
+        rect_a->size.w == rect_b->size.w && rect_a->size.h == rect_b->size.h;
+}
+
+GRect layer_get_frame(const Layer *layer) {
+    return layer->frame;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+    invalidate_frame(layer);
+    layer->frame = frame;
+    layer->bounds.size = frame.size;
+    layer_mark_dirty(layer);
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+    return layer->bounds;
+}
+
+// the obstruction covers the bottom of the screen, so it only takes height
+static int16_t obstruction;
+
+GRect layer_get_unobstructed_bounds(const Layer *layer) {
+    GRect bounds = layer->bounds;
+    int16_t top = layer->frame.origin.y;
+    for (Layer *parent = layer->parent; parent; parent = parent->parent) {
+        top += parent->frame.origin.y;
+    }
+    int16_t visible = SIM_SCREEN_HEIGHT - obstruction - top;
+    if (bounds.size.h > visible) {
+        bounds.size.h = visible > 0 ? visible : 0;
+    }
+    return bounds;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+    if (layer->hidden != hidden) {
+        layer->hidden = hidden;
+        layer_mark_dirty(layer);
+    }
+}
+
+bool layer_get_hidden(const Layer *layer) {
+    return layer->hidden;
+}
+
+TextLayer *text_layer_create(GRect frame) {
+    TextLayer *text_layer = sim_alloc(sizeof(TextLayer));
+    layer_init(&text_layer->layer, frame);
+    text_layer->layer.text_layer = text_layer;
+    text_layer->text = "";
+    return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+    if (text_layer) {
+        layer_remove_from_parent(&text_layer->layer);
+        sim_free(text_layer, sizeof(TextLayer));
+    }
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+    return &text_layer->layer;
+}
+
+// like the firmware, every setter invalidates the layer, changed or not
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+    text_layer->text = text;
+    layer_mark_dirty(&text_layer->layer);
+}
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+    return text_layer->text;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+    text_layer->font = font;
+    layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+    text_layer->text_color = color;
+    layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+    text_layer->background_color = color;
+    layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+    text_layer->alignment = text_alignment;
+    layer_mark_dirty(&text_layer->layer);
+}
+
+Window *window_create(void) {
+    Window *window = sim_alloc(sizeof(Window));
+    layer_init(&window->root, GRect(0, 0, SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT));
+    return window;
+}
+
+void window_destroy(Window *window) {
+    if (window->loaded && window->handlers.unload) {
+        window->handlers.unload(window);
+    }
+    sim_free(window, sizeof(Window));
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+    window->handlers = handlers;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+    window->background_color = background_color;
+    layer_mark_dirty(&window->root);
+}
+
+Layer *window_get_root_layer(const Window *window) {
+    return (Layer *)&window->root;
+}
+
+void window_stack_push(Window *window, bool animated) {
+    top_window = window;
+    if (!window->loaded && window->handlers.load) {
+        window->loaded = true;
+        window->handlers.load(window);
+    }
+    if (window->handlers.appear) {
+        window->handlers.appear(window);
+    }
+    layer_mark_dirty(&window->root);
+}
+
+// Text rows under a peek: where the glyphs of each text layer ink in a frame
+// drawn while the obstruction shows, clipped like the layer. The frame counts
+// when two of them overlap or one is cut by the top of the obstruction.
+#define TEXT_BOXES 32
+
+static GRect text_boxes[TEXT_BOXES];
+static const char *text_strings[TEXT_BOXES];
+static int text_box_count;
+static bool overlap_reported;
+
+// a single line, aligned by its advance
+static GRect text_ink(const TextLayer *text_layer, GRect frame) {
+    int16_t top = INT16_MAX;
+    int16_t bottom = INT16_MIN;
+    int16_t left = INT16_MAX;
+    int16_t right = INT16_MIN;
+    int16_t pen = 0;
+    const char *text = text_layer->font && text_layer->text ? text_layer->text : "";
+    while (*text) {
+        struct SimGlyph glyph = font_glyph(text_layer->font, next_code(&text));
+        if (glyph.bottom > glyph.top) {
+            top = glyph.top < top ? glyph.top : top;
+            bottom = glyph.bottom > bottom ? glyph.bottom : bottom;
+            left = pen + glyph.left < left ? pen + glyph.left : left;
+            right = pen + glyph.right > right ? pen + glyph.right : right;
+        }
+        pen += glyph.advance;
+    }
+    if (bottom <= top) {
+        return GRect(frame.origin.x, frame.origin.y, 0, 0);
+    }
+    int16_t x = frame.origin.x;
+    if (text_layer->alignment == GTextAlignmentCenter) {
+        x += (frame.size.w - pen) / 2;
+    } else if (text_layer->alignment == GTextAlignmentRight) {
+        x += frame.size.w - pen;
+    }
+    return GRect(x + left, frame.origin.y + top, right - left, bottom - top);
+}
+
+static void add_text_box(const TextLayer *text_layer, GRect frame, GRect visible) {
+    GRect ink = clip_rect(text_ink(text_layer, frame), visible);
+    if (ink.size.w && ink.size.h && text_box_count < TEXT_BOXES) {
+        text_boxes[text_box_count] = ink;
+        text_strings[text_box_count++] = text_layer->text;
+    }
+}
+
+static void print_text_box(int i) {
+    GRect *box = &text_boxes[i];
+    printf("\"%s\" at %d,%d %dx%d", text_strings[i], box->origin.x, box->origin.y, box->size.w, box->size.h);
+}
+
+static void check_text_rows() {
+    int16_t edge = SIM_SCREEN_HEIGHT - obstruction;
+    bool overlap = false;
+    for (int i = 0; i < text_box_count; ++i) {
+        GRect *box = &text_boxes[i];
+        bool cut = box->origin.y < edge && box->origin.y + box->size.h > edge;
+        for (int j = i + 1; j < text_box_count && !cut; ++j) {
+            if (clip_rect(*box, text_boxes[j]).size.w) {
+                overlap = true;
+                if (sim_verbose || !overlap_reported) {
+                    printf("text: ");
+                    print_text_box(i);
+                    printf(" overlaps ");
+                    print_text_box(j);
+                    printf("\n");
+                }
+            }
+        }
+        if (cut && (sim_verbose || !overlap_reported)) {
+            printf("text: ");
+            print_text_box(i);
+            printf(" is cut at %d by the obstruction\n", edge);
+        }
+        overlap = overlap || cut;
+    }
+    if (overlap) {
+        sim_counters.text_overlaps++;
+        overlap_reported = true;
+    }
+    text_box_count = 0;
+}
+
+static void paint_rect(GRect rect) {
+    for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; ++y) {
+        uint8_t *pixel = &frame_painted[y * SIM_SCREEN_WIDTH + rect.origin.x];
+        for (int x = 0; x < rect.size.w; ++x) {
+            if (pixel[x] < UINT8_MAX) {
+                pixel[x]++;
+            }
+        }
+    }
+}
+
+// origin is where the parent's bounds start on screen, clip what is left
+// visible of it
+static void draw_layer(Layer *layer, GContext *ctx, GPoint origin, GRect clip) {
+    if (layer->hidden) {
+        return;
+    }
+    ctx->layers_drawn++;
+    GRect frame = layer->frame;
+    frame.origin.x += origin.x;
+    frame.origin.y += origin.y;
+    GRect visible = clip_rect(frame, clip);
+    paint_rect(visible);
+    if (layer->text_layer && obstruction) {
+        add_text_box(layer->text_layer, frame, visible);
+    }
+    if (layer->update_proc) {
+        layer->update_proc(layer, ctx);
+    }
+    for (Layer *child = layer->first_child; child; child = child->next_sibling) {
+        draw_layer(child, ctx, frame.origin, visible);
+    }
+}
+
+static void print_frame_trace(uint32_t dirty, uint32_t painted, uint8_t overdraw) {
+    time_t now = sim_time(NULL);
+    char stamp[16];
+    strftime(stamp, sizeof(stamp), "%a %H:%M:%S", localtime(&now));
+    printf("%s.%03d frame: dirty %u px in", stamp, (int)(now_ms % 1000), dirty);
+    for (int i = 0; i < frame_rect_count; ++i) {
+        GRect *rect = &frame_rects[i];
+        printf(" %d,%d %dx%d", rect->origin.x, rect->origin.y, rect->size.w, rect->size.h);
+    }
+    printf(", painted %u px, overdraw %d\n", painted, overdraw);
+}
+
+void sim_render() {
+    if (!screen_dirty || !top_window) {
+        return;
+    }
+    screen_dirty = false;
+    sim_counters.frames++;
+    GContext ctx = { 0 };
+    draw_layer(&top_window->root, &ctx, GPoint(0, 0), GRect(0, 0, SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT));
+    check_text_rows();
+
+    uint32_t dirty = 0;
+    uint32_t painted = 0;
+    uint8_t overdraw = 0;
+    for (int y = 0; y < SIM_SCREEN_HEIGHT; ++y) {
+        for (int x = 0; x < SIM_SCREEN_WIDTH; ++x) {
+            int i = y * SIM_SCREEN_WIDTH + x;
+            if (on_display(x, y)) {
+                dirty += frame_dirty[i];
+                dirty_heat[i] += frame_dirty[i];
+                painted += frame_painted[i];
+                painted_heat[i] += frame_painted[i];
+                overdraw = frame_painted[i] > overdraw ? frame_painted[i] : overdraw;
+            }
+        }
+    }
+    if (sim_trace_frames) {
+        print_frame_trace(dirty, painted, overdraw);
+    }
+    sim_counters.dirty_pixels += dirty;
+    sim_counters.painted_pixels += painted;
+    screen_frames++;
+    screen_dirty_pixels += dirty;
+    screen_painted_pixels += painted;
+    peak_overdraw = overdraw > peak_overdraw ? overdraw : peak_overdraw;
+    memset(frame_dirty, 0, sizeof(frame_dirty));
+    memset(frame_painted, 0, sizeof(frame_painted));
+    frame_rect_count = 0;
+}
+
+void sim_print_screen_report() {
+    uint32_t pixels = 0;
+    for (int y = 0; y < SIM_SCREEN_HEIGHT; ++y) {
+        for (int x = 0; x < SIM_SCREEN_WIDTH; ++x) {
+            pixels += on_display(x, y);
+        }
+    }
+    if (!screen_frames) {
+        return;
+    }
+    printf("screen %u px: per frame %llu dirty, %llu painted, overdraw %.2f, peak %d\n", pixels,
+           (unsigned long long)(screen_dirty_pixels / screen_frames),
+           (unsigned long long)(screen_painted_pixels / screen_frames),
+           (double)screen_painted_pixels / screen_frames / pixels, peak_overdraw);
+}
+
+// black through blue, red and yellow to white
+static void heat_color(double level, uint8_t *rgb) {
+    static const uint8_t stops[][3] = {
+        { 0, 0, 0 }, { 0, 0, 160 }, { 200, 0, 0 }, { 255, 200, 0 }, { 255, 255, 255 }
+    };
+    int last = ARRAY_LENGTH(stops) - 1;
+    double at = (level < 0 ? 0 : level > 1 ? 1 : level) * last;
+    int stop = at >= last ? last - 1 : (int)at;
+    double mix = at - stop;
+    for (int c = 0; c < 3; ++c) {
+        rgb[c] = stops[stop][c] + (stops[stop + 1][c] - stops[stop][c]) * mix + 0.5;
+    }
+}
+
+static bool write_heatmap(const char *dir, const char *name, const uint32_t *heat) {
+    static uint8_t rgb[SCREEN_PIXELS * 3];
+    uint32_t peak = 1;
+    for (int i = 0; i < SCREEN_PIXELS; ++i) {
+        peak = heat[i] > peak ? heat[i] : peak;
+    }
+    for (int y = 0; y < SIM_SCREEN_HEIGHT; ++y) {
+        for (int x = 0; x < SIM_SCREEN_WIDTH; ++x) {
+            int i = y * SIM_SCREEN_WIDTH + x;
+            if (on_display(x, y)) {
+                heat_color((double)heat[i] / peak, &rgb[i * 3]);
+            } else {
+                memset(&rgb[i * 3], 48, 3);
+            }
+        }
+    }
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (!png_write_rgb(path, SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT, rgb)) {
+        fprintf(stderr, "hostsim: cannot write %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// both scaled to their own peak, which the report gives for overdraw
+bool sim_write_heatmaps(const char *dir) {
+    return write_heatmap(dir, "dirty.png", dirty_heat) && write_heatmap(dir, "overdraw.png", painted_heat);
+}
+
+// Persistent storage
+
+typedef struct {
+    uint32_t key;
+    uint16_t size;
+    bool used;
+    uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistEntry;
+
+#define PERSIST_ENTRIES 128
+
+static PersistEntry store[PERSIST_ENTRIES];
+
+static PersistEntry *find_entry(uint32_t key) {
+    for (int i = 0; i < PERSIST_ENTRIES; ++i) {
+        if (store[i].used && store[i].key == key) {
+            return &store[i];
+        }
+    }
+    return NULL;
+}
+
+static int write_entry(uint32_t key, const void *data, size_t size) {
+    if (size > PERSIST_DATA_MAX_LENGTH) {
+        size = PERSIST_DATA_MAX_LENGTH;
+    }
+    PersistEntry *entry = find_entry(key);
+    for (int i = 0; !entry && i < PERSIST_ENTRIES; ++i) {
+        if (!store[i].used) {
+            entry = &store[i];
+        }
+    }
+    if (!entry) {
+        return -1;
+    }
+    entry->used = true;
+    entry->key = key;
+    entry->size = size;
+    memcpy(entry->data, data, size);
+    sim_counters.persist_writes++;
+    sim_counters.persist_bytes += size;
+    return size;
+}
+
+bool persist_exists(const uint32_t key) {
+    return find_entry(key) != NULL;
+}
+
+int persist_get_size(const uint32_t key) {
+    PersistEntry *entry = find_entry(key);
+    return entry ? entry->size : E_DOES_NOT_EXIST;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+    int32_t value = 0;
+    PersistEntry *entry = find_entry(key);
+    if (entry) {
+        memcpy(&value, entry->data, entry->size < sizeof(value) ? entry->size : sizeof(value));
+    }
+    return value;
+}
+
+bool persist_read_bool(const uint32_t key) {
+    return persist_read_int(key) != 0;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+    PersistEntry *entry = find_entry(key);
+    if (!entry) {
+        return E_DOES_NOT_EXIST;
+    }
+    size_t size = entry->size < buffer_size ? entry->size : buffer_size;
+    memcpy(buffer, entry->data, size);
+    return size;
+}
+
+int persist_read_string(const uint32_t key, char *buffer, const size_t buffer_size) {
+    int size = persist_read_data(key, buffer, buffer_size);
+    if (size > 0) {
+        buffer[buffer_size - 1] = '\0';
+    }
+    return size;
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+    return write_entry(key, &value, sizeof(value));
+}
+
+int persist_write_bool(const uint32_t key, const bool value) {
+    return write_entry(key, &value, sizeof(value));
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+    return write_entry(key, data, size);
+}
+
+int persist_write_string(const uint32_t key, const char *cstring) {
+    return write_entry(key, cstring, strlen(cstring) + 1);
+}
+
+int persist_delete(const uint32_t key) {
+    PersistEntry *entry = find_entry(key);
+    if (!entry) {
+        return E_DOES_NOT_EXIST;
+    }
+    entry->used = false;
+    return 0;
+}
+
+// the state file holds the used entries as they are in memory, so a launch
+// can start from what the previous run left
+
+bool sim_load_persist(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    memset(store, 0, sizeof(store));
+    for (int i = 0; i < PERSIST_ENTRIES && fread(&store[i], sizeof(store[i]), 1, file) == 1; ++i) {
+    }
+    fclose(file);
+    return true;
+}
+
+void sim_save_persist(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "hostsim: can't write %s\n", path);
+        return;
+    }
+    for (int i = 0; i < PERSIST_ENTRIES; ++i) {
+        if (store[i].used) {
+            fwrite(&store[i], sizeof(store[i]), 1, file);
+        }
+    }
+    fclose(file);
+}
+
+// Dictionaries, laid out like the SDK's: tuples back to back
+
+struct DictionaryIterator {
+    uint8_t *begin;
+    uint8_t *end;
+    uint8_t *cursor;
+    size_t capacity;
+    bool overflow;
+};
+
+static Tuple *next_tuple(const DictionaryIterator *iter, const uint8_t *at) {
+    return at < iter->end ? (Tuple *)at : NULL;
+}
+
+static const uint8_t *skip_tuple(const Tuple *tuple) {
+    return (const uint8_t *)tuple + sizeof(Tuple) + tuple->length;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+    for (Tuple *tuple = next_tuple(iter, iter->begin); tuple; tuple = next_tuple(iter, skip_tuple(tuple))) {
+        if (tuple->key == key) {
+            return tuple;
+        }
+    }
+    return NULL;
+}
+
+// with the tuple count byte the SDK's header starts with
+uint32_t dict_size(DictionaryIterator *iter) {
+    return 1 + (iter->end - iter->begin);
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+    iter->cursor = iter->begin;
+    return next_tuple(iter, iter->cursor);
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+    Tuple *tuple = next_tuple(iter, iter->cursor);
+    if (!tuple) {
+        return NULL;
+    }
+    iter->cursor = (uint8_t *)skip_tuple(tuple);
+    return next_tuple(iter, iter->cursor);
+}
+
+static DictionaryResult write_tuple(DictionaryIterator *iter, uint32_t key, TupleType type, const void *data, uint16_t size) {
+    if (!iter) {
+        return DICT_INVALID_ARGS;
+    }
+    if (iter->end + sizeof(Tuple) + size > iter->begin + iter->capacity) {
+        iter->overflow = true;
+        return DICT_NOT_ENOUGH_STORAGE;
+    }
+    Tuple *tuple = (Tuple *)iter->end;
+    tuple->key = key;
+    tuple->type = type;
+    tuple->length = size;
+    memcpy(tuple->value->data, data, size);
+    iter->end += sizeof(Tuple) + size;
+    return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t *data, const uint16_t size) {
+    return write_tuple(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char *cstring) {
+    return write_tuple(iter, key, TUPLE_CSTRING, cstring, strlen(cstring) + 1);
+}
+
+DictionaryResult dict_write_int(DictionaryIterator *iter, const uint32_t key, const void *integer, const uint8_t width_bytes, const bool is_signed) {
+    return write_tuple(iter, key, is_signed ? TUPLE_INT : TUPLE_UINT, integer, width_bytes);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value) {
+    return write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value) {
+    return write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value) {
+    return write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int8(DictionaryIterator *iter, const uint32_t key, const int8_t value) {
+    return write_tuple(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int16(DictionaryIterator *iter, const uint32_t key, const int16_t value) {
+    return write_tuple(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) {
+    return write_tuple(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+static void dict_reset(DictionaryIterator *iter, uint8_t *buffer, size_t capacity) {
+    iter->begin = iter->end = iter->cursor = buffer;
+    iter->capacity = capacity;
+    iter->overflow = false;
+}
+
+// AppMessage: the outbox is delivered to the scenario's phone after a
+// round trip, and stays busy until then
+
+#define ROUND_TRIP_MS 400
+
+static AppMessageInboxReceived inbox_received;
+static AppMessageInboxDropped inbox_dropped;
+static AppMessageOutboxSent outbox_sent;
+static AppMessageOutboxFailed outbox_failed;
+
+static uint8_t *inbox_buffer;
+static uint8_t *outbox_buffer;
+static uint32_t inbox_size;
+static uint32_t outbox_size;
+static DictionaryIterator outbox;
+static bool outbox_open;
+static bool outbox_in_flight;
+static bool connected = true;
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+    inbox_buffer = sim_alloc(size_inbound);
+    outbox_buffer = sim_alloc(size_outbound);
+    inbox_size = size_inbound;
+    outbox_size = size_outbound;
+    return APP_MSG_OK;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+    AppMessageInboxReceived previous = inbox_received;
+    inbox_received = received_callback;
+    return previous;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback) {
+    AppMessageInboxDropped previous = inbox_dropped;
+    inbox_dropped = dropped_callback;
+    return previous;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+    AppMessageOutboxSent previous = outbox_sent;
+    outbox_sent = sent_callback;
+    return previous;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) {
+    AppMessageOutboxFailed previous = outbox_failed;
+    outbox_failed = failed_callback;
+    return previous;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+    if (!outbox_buffer) {
+        return APP_MSG_INVALID_ARGS;
+    }
+    if (outbox_in_flight || outbox_open) {
+        *iterator = NULL;
+        return APP_MSG_BUSY;
+    }
+    dict_reset(&outbox, outbox_buffer, outbox_size);
+    outbox_open = true;
+    *iterator = &outbox;
+    return APP_MSG_OK;
+}
+
+static void outbox_delivered(int success) {
+    outbox_in_flight = false;
+    if (success) {
+        sim_phone_received(&outbox);
+        if (outbox_sent) {
+            outbox_sent(&outbox, NULL);
+        }
+    } else {
+        sim_counters.messages_failed++;
+        if (outbox_failed) {
+            outbox_failed(&outbox, APP_MSG_NOT_CONNECTED, NULL);
+        }
+    }
+}
+
+AppMessageResult app_message_outbox_send(void) {
+    if (!outbox_open) {
+        return APP_MSG_INVALID_ARGS;
+    }
+    outbox_open = false;
+    outbox_in_flight = true;
+    sim_counters.messages_out++;
+    spend_ms(OUTBOX_SEND_MS);
+    sim_schedule(ROUND_TRIP_MS, outbox_delivered, connected);
+    return APP_MSG_OK;
+}
+
+void sim_send_to_watch(SimDictBuilder builder, int arg) {
+    if (!connected || !inbox_buffer) {
+        return;
+    }
+    DictionaryIterator inbox;
+    dict_reset(&inbox, inbox_buffer, inbox_size);
+    builder(&inbox, arg);
+    if (inbox.overflow) {
+        // the firmware would drop the whole message
+        fprintf(stderr, "hostsim: message to the watch doesn't fit the %u byte inbox\n", (unsigned)inbox_size);
+        sim_counters.messages_failed++;
+        if (inbox_dropped) {
+            inbox_dropped(APP_MSG_BUFFER_OVERFLOW, NULL);
+        }
+        return;
+    }
+    sim_counters.messages_in++;
+    if (inbox_received) {
+        inbox_received(&inbox, NULL);
+    }
+}
+
+// Event services
+
+static TickHandler tick_handler;
+static BatteryStateHandler battery_handler;
+static ConnectionHandlers connection_handlers;
+static BatteryChargeState battery = { .charge_percent = 100 };
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+    tick_handler = handler;
+}
+
+void tick_timer_service_unsubscribe(void) {
+    tick_handler = NULL;
+}
+
+void sim_tick(TimeUnits units_changed) {
+    if (tick_handler) {
+        time_t now = sim_time(NULL);
+        tick_handler(localtime(&now), units_changed);
+    }
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+    battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+    battery_handler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void) {
+    return battery;
+}
+
+void sim_set_battery(uint8_t percent, bool charging) {
+    battery.charge_percent = percent;
+    battery.is_charging = charging;
+    battery.is_plugged = charging;
+    if (battery_handler) {
+        battery_handler(battery);
+    }
+}
+
+void connection_service_subscribe(ConnectionHandlers conn_handlers) {
+    connection_handlers = conn_handlers;
+}
+
+void connection_service_unsubscribe(void) {
+    memset(&connection_handlers, 0, sizeof(connection_handlers));
+}
+
+bool connection_service_peek_pebble_app_connection(void) {
+    return connected;
+}
+
+bool sim_is_connected() {
+    return connected;
+}
+
+void sim_set_connected(bool now_connected) {
+    connected = now_connected;
+    if (connection_handlers.pebble_app_connection_handler) {
+        connection_handlers.pebble_app_connection_handler(connected);
+    }
+}
+
+void vibes_short_pulse(void) {
+}
+
+void vibes_long_pulse(void) {
+}
+
+void vibes_double_pulse(void) {
+}
+
+// Quick View slides in over OBSTRUCTION_STEPS frames, reporting progress to
+// the change handler as the firmware does
+#define OBSTRUCTION_STEPS 8
+#define OBSTRUCTION_STEP_MS 32
+
+static UnobstructedAreaHandlers obstruction_handlers;
+static void *obstruction_context;
+static int16_t obstruction_from;
+static int16_t obstruction_to;
+
+static void obstruction_step(int step) {
+    obstruction = obstruction_from + (obstruction_to - obstruction_from) * step / OBSTRUCTION_STEPS;
+    if (obstruction_handlers.change) {
+        obstruction_handlers.change((AnimationProgress)ANIMATION_NORMALIZED_MAX * step / OBSTRUCTION_STEPS,
+                                    obstruction_context);
+    }
+    if (step < OBSTRUCTION_STEPS) {
+        sim_schedule(OBSTRUCTION_STEP_MS, obstruction_step, step + 1);
+    } else if (obstruction_handlers.did_change) {
+        obstruction_handlers.did_change(obstruction_context);
+    }
+}
+
+void sim_set_obstruction(int16_t height) {
+    if (height == obstruction_to) {
+        return;
+    }
+    obstruction_from = obstruction;
+    obstruction_to = height;
+    if (obstruction_handlers.will_change) {
+        obstruction_handlers.will_change(GRect(0, 0, SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT - height),
+                                         obstruction_context);
+    }
+    sim_schedule(OBSTRUCTION_STEP_MS, obstruction_step, 1);
+}
+
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers, void *context) {
+    obstruction_handlers = handlers;
+    obstruction_context = context;
+}
+
+void unobstructed_area_service_unsubscribe(void) {
+    obstruction_handlers = (UnobstructedAreaHandlers) { 0 };
+}
+
+// Timers and scheduled events share one timeline
+
+#define SIM_EVENTS 32
+
+struct AppTimer {
+    uint64_t due;
+    AppTimerCallback callback;
+    void *data;
+    SimEventCallback event;
+    int arg;
+    bool active;
+};
+
+static struct AppTimer events[SIM_EVENTS];
+
+static struct AppTimer *add_event(uint32_t delay_ms) {
+    for (int i = 0; i < SIM_EVENTS; ++i) {
+        if (!events[i].active) {
+            memset(&events[i], 0, sizeof(events[i]));
+            events[i].active = true;
+            events[i].due = now_ms + delay_ms;
+            return &events[i];
+        }
+    }
+    fprintf(stderr, "hostsim: out of timers\n");
+    abort();
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+    AppTimer *timer = add_event(timeout_ms);
+    timer->callback = callback;
+    timer->data = callback_data;
+    return timer;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+    if (!timer_handle || !timer_handle->active) {
+        return false;
+    }
+    timer_handle->due = now_ms + new_timeout_ms;
+    return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+    if (timer_handle) {
+        timer_handle->active = false;
+    }
+}
+
+void sim_schedule(uint32_t delay_ms, SimEventCallback callback, int arg) {
+    struct AppTimer *event = add_event(delay_ms);
+    event->event = callback;
+    event->arg = arg;
+}
+
+void sim_run_until(uint64_t until_ms) {
+    for (;;) {
+        struct AppTimer *next = NULL;
+        for (int i = 0; i < SIM_EVENTS; ++i) {
+            if (events[i].active && events[i].due <= until_ms && (!next || events[i].due < next->due)) {
+                next = &events[i];
+            }
+        }
+        if (!next) {
+            break;
+        }
+        if (next->due > now_ms) {
+            now_ms = next->due;
+        }
+        struct AppTimer fired = *next;
+        next->active = false;
+        if (fired.callback) {
+            sim_counters.timers++;
+            fired.callback(fired.data);
+        } else {
+            fired.event(fired.arg);
+        }
+        sim_render();
+    }
+    if (now_ms < until_ms) {
+        now_ms = until_ms; // the face may have spent past it
+    }
+    sim_render();
+}
+
+// Health, reported from the scenario's sleep schedule
+
+#if defined(PBL_HEALTH)
+static HealthEventHandler health_handler;
+static void *health_context;
+
+#define STEPS_PER_AWAKE_MINUTE 9
+#define METERS_PER_STEP 7 / 10
+#define RESTING_KCAL_PER_HOUR 70
+#define ACTIVE_KCAL_PER_1000_STEPS 40
+
+static HealthValue sum_minutes(HealthMetric metric, time_t start, time_t end) {
+    int awake = 0;
+    int asleep = 0;
+    int restful = 0;
+    for (time_t t = start; t < end; t += SECONDS_PER_MINUTE) {
+        if (sim_is_asleep(t)) {
+            asleep++;
+            if ((t / SECONDS_PER_MINUTE) % 90 < 25) { // a deep phase per cycle
+                restful++;
+            }
+        } else {
+            awake++;
+        }
+    }
+    int steps = awake * STEPS_PER_AWAKE_MINUTE;
+    switch (metric) {
+        case HealthMetricStepCount:
+            return steps;
+        case HealthMetricActiveSeconds:
+            return awake * 6;
+        case HealthMetricWalkedDistanceMeters:
+            return steps * METERS_PER_STEP;
+        case HealthMetricSleepSeconds:
+            return asleep * SECONDS_PER_MINUTE;
+        case HealthMetricSleepRestfulSeconds:
+            return restful * SECONDS_PER_MINUTE;
+        case HealthMetricRestingKCalories:
+            return (awake + asleep) * RESTING_KCAL_PER_HOUR / 60;
+        case HealthMetricActiveKCalories:
+            return steps * ACTIVE_KCAL_PER_1000_STEPS / 1000;
+        default:
+            return 0;
+    }
+}
+
+HealthValue health_service_sum(HealthMetric metric, time_t time_start, time_t time_end) {
+    sim_counters.health_calls++;
+    spend_ms(HEALTH_QUERY_MS);
+    return sum_minutes(metric, time_start, time_end);
+}
+
+HealthValue health_service_sum_today(HealthMetric metric) {
+    sim_counters.health_calls++;
+    spend_ms(HEALTH_QUERY_MS);
+    time_t now = sim_time(NULL);
+    if (metric == HealthMetricSleepSeconds || metric == HealthMetricSleepRestfulSeconds) {
+        // the firmware attributes last night to today
+        return sum_minutes(metric, time_start_of_today() - 6 * SECONDS_PER_HOUR, now);
+    }
+    return sum_minutes(metric, time_start_of_today(), now);
+}
+
+HealthValue health_service_sum_averaged(HealthMetric metric, time_t time_start, time_t time_end, HealthServiceTimeScope scope) {
+    sim_counters.health_calls++;
+    spend_ms(HEALTH_QUERY_MS);
+    // a typical day is the simulated one, a little more active
+    return sum_minutes(metric, time_start, time_end) * 11 / 10;
+}
+
+HealthServiceAccessibilityMask health_service_metric_accessible(HealthMetric metric, time_t time_start, time_t time_end) {
+    sim_counters.health_calls++;
+    return HealthServiceAccessibilityMaskAvailable;
+}
+
+HealthServiceAccessibilityMask health_service_metric_averaged_accessible(HealthMetric metric, time_t time_start, time_t time_end, HealthServiceTimeScope scope) {
+    sim_counters.health_calls++;
+    return HealthServiceAccessibilityMaskAvailable;
+}
+
+HealthActivityMask health_service_peek_current_activities(void) {
+    sim_counters.health_calls++;
+    return sim_is_asleep(sim_time(NULL)) ? HealthActivitySleep : HealthActivityNone;
+}
+
+bool health_service_events_subscribe(HealthEventHandler handler, void *context) {
+    health_handler = handler;
+    health_context = context;
+    return true;
+}
+
+bool health_service_events_unsubscribe(void) {
+    health_handler = NULL;
+    return true;
+}
+
+MeasurementSystem health_service_get_measurement_system_for_display(HealthMetric metric) {
+    return MeasurementSystemMetric;
+}
+
+void sim_health_event(HealthEventType event) {
+    if (health_handler) {
+        health_handler(event, health_context);
+    }
+}
+#endif
+
+// Data logging goes nowhere
+
+DataLoggingSessionRef data_logging_create(uint32_t tag, DataLoggingItemType item_type, uint16_t item_length, bool resume) {
+    static int session;
+    return &session;
+}
+
+DataLoggingResult data_logging_log(DataLoggingSessionRef logging_session, const void *data, uint32_t num_items) {
+    return DATA_LOGGING_SUCCESS;
+}
+
+void data_logging_finish(DataLoggingSessionRef logging_session) {
+}
+
+// The scenario replaces the event loop
+
+void sim_event_loop();
+
+void app_event_loop(void) {
+    sim_event_loop();
+}
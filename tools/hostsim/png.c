@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "png.h"
+
+#define STORED_BLOCK_MAX 65535
+
+static uint32_t crc_table[256];
+
+static void init_crc_table() {
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void put_u32(uint8_t *out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+static void write_chunk(FILE *file, const char *type, const uint8_t *data, size_t length) {
+    uint8_t header[8];
+    uint8_t trailer[4];
+    put_u32(header, length);
+    memcpy(header + 4, type, 4);
+    uint32_t crc = crc_update(0xFFFFFFFFu, header + 4, 4);
+    crc = crc_update(crc, data, length) ^ 0xFFFFFFFFu;
+    put_u32(trailer, crc);
+    fwrite(header, 1, sizeof(header), file);
+    if (length) {
+        fwrite(data, 1, length, file);
+    }
+    fwrite(trailer, 1, sizeof(trailer), file);
+}
+
+bool png_write_rgb(const char *path, int width, int height, const uint8_t *rgb) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    if (!crc_table[1]) {
+        init_crc_table();
+    }
+
+    // each row is prefixed with filter type 0, none
+    size_t row = 1 + (size_t)width * 3;
+    size_t raw_length = row * height;
+    uint8_t *raw = malloc(raw_length);
+    for (int y = 0; y < height; ++y) {
+        raw[y * row] = 0;
+        memcpy(raw + y * row + 1, rgb + (size_t)y * width * 3, width * 3);
+    }
+
+    // zlib header, stored blocks of up to 64k each, adler32 of the raw data
+    size_t blocks = (raw_length + STORED_BLOCK_MAX - 1) / STORED_BLOCK_MAX;
+    size_t zlib_length = 2 + blocks * 5 + raw_length + 4;
+    uint8_t *zlib = malloc(zlib_length);
+    uint8_t *out = zlib;
+    *out++ = 0x78;
+    *out++ = 0x01;
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t offset = 0; offset < raw_length; offset += STORED_BLOCK_MAX) {
+        size_t length = raw_length - offset < STORED_BLOCK_MAX ? raw_length - offset : STORED_BLOCK_MAX;
+        *out++ = offset + length == raw_length; // BFINAL, BTYPE 00
+        *out++ = length & 0xFF;
+        *out++ = length >> 8;
+        *out++ = ~length & 0xFF;
+        *out++ = (~length >> 8) & 0xFF;
+        memcpy(out, raw + offset, length);
+        out += length;
+        for (size_t i = 0; i < length; ++i) {
+            a = (a + raw[offset + i]) % 65521;
+            b = (b + a) % 65521;
+        }
+    }
+    put_u32(out, (b << 16) | a);
+
+    uint8_t ihdr[13];
+    put_u32(ihdr, width);
+    put_u32(ihdr + 4, height);
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 2;  // truecolor
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // no interlace
+
+    fwrite(signature, 1, sizeof(signature), file);
+    write_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+    write_chunk(file, "IDAT", zlib, zlib_length);
+    write_chunk(file, "IEND", NULL, 0);
+    free(raw);
+    free(zlib);
+    return fclose(file) == 0;
+}
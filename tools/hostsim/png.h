@@ -0,0 +1,12 @@
+// Minimal PNG writer for the heatmaps: 8 bit RGB, stored (uncompressed)
+// deflate blocks, so no zlib is needed.
+#ifndef __HOSTSIM_PNG_
+#define __HOSTSIM_PNG_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// rgb holds width * height pixels, three bytes each, rows top to bottom
+bool png_write_rgb(const char *path, int width, int height, const uint8_t *rgb);
+
+#endif
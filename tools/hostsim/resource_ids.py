@@ -0,0 +1,163 @@
+#!/usr/bin/env python
+"""
+Writes the RESOURCE_ID_* enum the SDK would generate from package.json, the
+table of resource files the host stubs load them from, and the glyph metrics
+of the fonts, rendered at the pixel size of their name like fontgen does.
+
+Usage: python tools/hostsim/resource_ids.py <output header>
+"""
+
+from __future__ import print_function
+
+import io
+import json
+import os
+import re
+import struct
+import sys
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+
+try:
+    unichr
+except NameError:
+    unichr = chr
+
+# glyphs ' ' through '~' by character, the icons of the private use area
+# in a list
+FIRST_GLYPH = 0x20
+ASCII_GLYPHS = 0x7f - FIRST_GLYPH
+SYMBOLS = range(0xf000, 0xf100)
+
+
+def ceil_div(a, b):
+    return -(-a // b)
+
+
+class TrueType(object):
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        count = self.unpack('>H', 4)[0]
+        self.tables = {}
+        for i in range(count):
+            tag, _, offset, _ = self.unpack('>4sIII', 12 + 16 * i)
+            self.tables[tag.decode('ascii')] = offset
+        head = self.tables['head']
+        self.units_per_em = self.unpack('>H', head + 18)[0]
+        self.long_loca = self.unpack('>h', head + 50)[0] == 1
+        self.long_metrics = self.unpack('>H', self.tables['hhea'] + 34)[0]
+        self.glyph_ids = self.read_cmap()
+
+    def unpack(self, fmt, offset):
+        return struct.unpack(fmt, self.data[offset:offset + struct.calcsize(fmt)])
+
+    # the format 4 subtable, which covers the basic plane all these fonts use
+    def read_cmap(self):
+        cmap = self.tables['cmap']
+        glyph_ids = {}
+        for i in range(self.unpack('>H', cmap + 2)[0]):
+            platform, _, offset = self.unpack('>HHI', cmap + 4 + 8 * i)
+            table = cmap + offset
+            if platform not in (0, 3) or self.unpack('>H', table)[0] != 4:
+                continue
+            segments = self.unpack('>H', table + 6)[0] // 2
+            ends = self.unpack('>%dH' % segments, table + 14)
+            starts = self.unpack('>%dH' % segments, table + 16 + 2 * segments)
+            deltas = self.unpack('>%dh' % segments, table + 16 + 4 * segments)
+            range_offsets = table + 16 + 6 * segments
+            for k in range(segments):
+                range_offset = self.unpack('>H', range_offsets + 2 * k)[0]
+                for c in range(starts[k], min(ends[k], 0xfffe) + 1):
+                    if range_offset:
+                        glyph = self.unpack('>H', range_offsets + 2 * k + range_offset + 2 * (c - starts[k]))[0]
+                        glyph = (glyph + deltas[k]) & 0xffff if glyph else 0
+                    else:
+                        glyph = (c + deltas[k]) & 0xffff
+                    glyph_ids[c] = glyph
+            return glyph_ids
+        return glyph_ids
+
+    # ink top and bottom from the top of the line, left and right from the
+    # pen, and the advance, in pixels
+    def glyph(self, code, size):
+        glyph = self.glyph_ids.get(code, 0)
+        if not glyph:
+            return None
+        scale = self.units_per_em
+        metric = min(glyph, self.long_metrics - 1)
+        advance = self.unpack('>H', self.tables['hmtx'] + 4 * metric)[0]
+        if self.long_loca:
+            start, end = self.unpack('>II', self.tables['loca'] + 4 * glyph)
+        else:
+            start, end = (2 * x for x in self.unpack('>HH', self.tables['loca'] + 2 * glyph))
+        # fontgen sets the pixel size and hangs every glyph from it, so the
+        # baseline sits the size down the line
+        baseline = size
+        advance = (advance * size + scale // 2) // scale
+        if start == end:
+            return 0, 0, 0, 0, advance
+        x_min, y_min, x_max, y_max = self.unpack('>hhhh', self.tables['glyf'] + start + 2)
+        return (baseline - ceil_div(y_max * size, scale), baseline - y_min * size // scale,
+                x_min * size // scale, ceil_div(x_max * size, scale), advance)
+
+
+# the glyphs of the characters a font resource keeps, by code
+def font_glyphs(resource):
+    font = TrueType(os.path.join(ROOT, 'resources', resource['file']))
+    size = int(resource['name'].rsplit('_', 1)[1])
+    pattern = re.compile(resource.get('characterRegex', '.'))
+    glyphs = {}
+    for code in list(range(FIRST_GLYPH, 0x7f)) + list(SYMBOLS):
+        glyph = font.glyph(code, size) if pattern.match(unichr(code)) else None
+        if glyph:
+            glyphs[code] = glyph
+    return glyphs
+
+
+def glyph_initializer(glyph):
+    return '{{ {}, {}, {}, {}, {} }}'.format(*glyph)
+
+
+def main(argv):
+    with io.open(os.path.join(ROOT, 'package.json'), encoding='utf-8') as f:
+        media = json.load(f)['pebble']['resources']['media']
+
+    lines = ['// generated by tools/hostsim/resource_ids.py, do not edit',
+             '#ifndef __HOSTSIM_RESOURCE_IDS_',
+             '#define __HOSTSIM_RESOURCE_IDS_',
+             '',
+             'typedef enum {',
+             '    RESOURCE_ID_INVALID = 0,']
+    lines.extend('    RESOURCE_ID_{},'.format(m['name']) for m in media)
+    lines.extend(['} ResourceId;',
+                  '',
+                  '#define SIM_RESOURCE_COUNT {}'.format(len(media) + 1),
+                  '#define SIM_RESOURCE_FILES { NULL, \\'])
+    lines.extend('    "resources/{}", \\'.format(m['file']) for m in media)
+    lines.extend(['}',
+                  '',
+                  '#define SIM_FIRST_GLYPH {}'.format(FIRST_GLYPH),
+                  '#define SIM_FONT_GLYPHS {}'.format(ASCII_GLYPHS),
+                  '#define SIM_RESOURCE_GLYPHS { { { 0 } }, \\'])
+    symbols = []
+    for i, m in enumerate(media):
+        glyphs = font_glyphs(m) if m['type'] == 'font' else {}
+        ascii = (glyphs.get(code, (0, 0, 0, 0, 0)) for code in range(FIRST_GLYPH, 0x7f))
+        lines.append('    {{ {} }}, \\'.format(', '.join(glyph_initializer(g) for g in ascii)))
+        symbols.extend('    {{ {}, 0x{:x}, {} }}, \\'.format(i + 1, code, glyph_initializer(glyphs[code]))
+                       for code in sorted(glyphs) if code in SYMBOLS)
+    lines.extend(['}',
+                  '',
+                  '#define SIM_SYMBOL_COUNT {}'.format(len(symbols)),
+                  '#define SIM_RESOURCE_SYMBOLS { \\'])
+    lines.extend(symbols)
+    lines.extend(['}', '', '#endif', ''])
+
+    with io.open(argv[0], 'w', encoding='utf-8') as f:
+        f.write(u'\n'.join(lines))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,537 @@
+// Replays a simulated week of wearing the watch against the face compiled
+// for the host, and reports what it cost per day.
+//
+// The day: asleep from 23:30 to 07:00, a 20 minute Bluetooth drop at 15:00,
+// the settings saved again at 12:00 (alternating the font, alt zone CET and
+// a JST clock in a slot), a Quick View peek from 09:00 to 09:30 where the
+// platform has one, charging from 19:00 to 20:00, and a health event every
+// 15 minutes. The phone answers weather, update and timezone table requests
+// after a round trip.
+//
+// Screen cost is reported in thousands of pixels a day: dirty is what was
+// invalidated, paint what the layers covered while redrawing it. With -o
+// the dirty and overdraw heatmaps of the run are written to a directory,
+// with -f every frame is traced. Every frame drawn under the peek is checked
+// for text rows overlapping or cut by it, with the glyph metrics of the
+// fonts. At the end the face's own energy estimate is requested and
+// printed, see src/energy.c.
+//
+// With -c the totals and the energy estimate are compared against a
+// baseline file, exiting with 1 when any of them grew or the scheduling of
+// the week changed; -w writes one. The scheduler's slices show up there:
+// health queries and sends take virtual time, see pebble_stub.c.
+#include <pebble.h>
+#include <getopt.h>
+#include "keys.h"
+#include "energy.h"
+#include "scheduler.h"
+#include "sim.h"
+
+#define MINUTES_PER_DAY (24 * MINUTES_PER_HOUR)
+#define SLEEP_START (23 * MINUTES_PER_HOUR + 30)
+#define SLEEP_END (7 * MINUTES_PER_HOUR)
+#define BT_DROP_START (15 * MINUTES_PER_HOUR)
+#define BT_DROP_END (BT_DROP_START + 20)
+#define CONFIG_AT (12 * MINUTES_PER_HOUR)
+#define CHARGE_START (19 * MINUTES_PER_HOUR)
+#define CHARGE_END (20 * MINUTES_PER_HOUR)
+#define PEEK_START (9 * MINUTES_PER_HOUR)
+#define PEEK_END (PEEK_START + 30)
+#define PEEK_HEIGHT 51
+#define BATTERY_DRAIN_MINUTES 144 // 10% a day
+#define PHONE_REPLY_MS 1500
+
+int timeboxed_main(void);
+
+static int days = 7;
+static const char *heatmap_dir;
+static SimCounters week;
+static uint32_t energy_total;
+static time_t start_time;
+static uint8_t battery_percent = 100;
+static bool charger = true;
+
+static int minute_of_day(time_t when) {
+    struct tm *local = localtime(&when);
+    return local->tm_hour * MINUTES_PER_HOUR + local->tm_min;
+}
+
+bool sim_is_asleep(time_t when) {
+    int minute = minute_of_day(when);
+    return minute >= SLEEP_START || minute < SLEEP_END;
+}
+
+// Phone side
+
+// last Sunday of the month, 01:00 UTC
+static time_t eu_transition(int year, int month) {
+    struct tm last = { .tm_year = year - 1900, .tm_mon = month + 1, .tm_mday = 0, .tm_hour = 1 };
+    time_t at = timegm(&last);
+    return at - gmtime(&at)->tm_wday * SECONDS_PER_DAY;
+}
+
+// what the phone computes for CET, see timezoneTransitions in the JS
+static void write_transitions(DictionaryIterator *iter) {
+    time_t now = time(NULL);
+    int year = gmtime(&now)->tm_year + 1900;
+    uint8_t table[TZ_TRANSITIONS * TZ_TRANSITION_SIZE];
+    int count = 0;
+    for (int y = year - 1; y <= year + 3 && count < TZ_TRANSITIONS; ++y) {
+        time_t changes[2] = { eu_transition(y, 2), eu_transition(y, 9) };
+        int16_t offsets[2] = { 120, 60 };
+        for (int i = 0; i < 2 && count < TZ_TRANSITIONS; ++i) {
+            time_t next = i == 0 ? changes[1] : eu_transition(y + 1, 2);
+            if (next <= now) {
+                continue; // superseded before now
+            }
+            uint8_t *entry = table + count++ * TZ_TRANSITION_SIZE;
+            int32_t at = changes[i];
+            memcpy(entry, &at, sizeof(at));
+            memcpy(entry + 4, &offsets[i], sizeof(offsets[i]));
+        }
+    }
+    dict_write_data(iter, KEY_TZTRANSITIONS, table, sizeof(table));
+}
+
+static void write_transitions_only(DictionaryIterator *iter, int unused) {
+    write_transitions(iter);
+}
+
+// laid out like the JS sends it: checkboxes as single bytes, the rest as
+// 32 bit numbers, weather keys and location kept on the phone
+static void write_config(DictionaryIterator *iter, int font_type) {
+    dict_write_int8(iter, KEY_ENABLEHEALTH, 1);
+    dict_write_int8(iter, KEY_USEKM, 1);
+    dict_write_int8(iter, KEY_USECAL, 0);
+    dict_write_int8(iter, KEY_SHOWSLEEP, 1);
+    dict_write_int8(iter, KEY_ENABLEWEATHER, 1);
+    dict_write_int8(iter, KEY_USECELSIUS, 1);
+    dict_write_int32(iter, KEY_TIMEZONES, 1);
+    dict_write_int32(iter, KEY_TIMEZONESMINUTES, 0);
+    dict_write_cstring(iter, KEY_TIMEZONESCODE, "CET");
+    dict_write_int32(iter, KEY_TIMEZONES2, 9);
+    dict_write_int32(iter, KEY_TIMEZONES2MINUTES, 0);
+    dict_write_cstring(iter, KEY_TIMEZONES2CODE, "JST");
+    dict_write_int32(iter, KEY_BGCOLOR, 0x000000);
+    dict_write_int32(iter, KEY_HOURSCOLOR, 0xFFFFFF);
+    dict_write_int8(iter, KEY_ENABLEADVANCED, 1);
+    dict_write_int32(iter, KEY_DATECOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_ALTHOURSCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_BATTERYCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_BATTERYLOWCOLOR, 0xFF0000);
+    dict_write_int32(iter, KEY_WEATHERCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_TEMPCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_MINCOLOR, 0x00FFFF);
+    dict_write_int32(iter, KEY_MAXCOLOR, 0xFF5500);
+    dict_write_int32(iter, KEY_WINDDIRCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_WINDSPEEDCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_STEPSCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_DISTCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_CALCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_SLEEPCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_DEEPCOLOR, 0xFFFFFF);
+    dict_write_int32(iter, KEY_STEPSBEHINDCOLOR, 0xFFFF00);
+    dict_write_int32(iter, KEY_DISTBEHINDCOLOR, 0xFFFF00);
+    dict_write_int32(iter, KEY_CALBEHINDCOLOR, 0xFFFF00);
+    dict_write_int32(iter, KEY_SLEEPBEHINDCOLOR, 0xFFFF00);
+    dict_write_int32(iter, KEY_DEEPBEHINDCOLOR, 0xFFFF00);
+    dict_write_int32(iter, KEY_FONTTYPE, font_type);
+    dict_write_int8(iter, KEY_BLUETOOTHDISCONNECT, 1);
+    dict_write_int32(iter, KEY_BLUETOOTHCOLOR, 0xFF0000);
+    dict_write_int8(iter, KEY_UPDATE, 0);
+    dict_write_int32(iter, KEY_UPDATECOLOR, 0x00FF00);
+    dict_write_int32(iter, KEY_LOCALE, LC_ENGLISH);
+    dict_write_int32(iter, KEY_DATEFORMAT, FORMAT_WMD);
+    dict_write_int32(iter, KEY_TEXTALIGN, ALIGN_CENTER);
+    dict_write_int32(iter, KEY_SPEEDUNIT, UNIT_KPH);
+    dict_write_int8(iter, KEY_LEADINGZERO, 0);
+    dict_write_int8(iter, KEY_SIMPLEMODE, 0);
+    dict_write_int32(iter, KEY_SLOTA, MODULE_WEATHER);
+    dict_write_int32(iter, KEY_SLOTB, MODULE_FORECAST);
+    dict_write_int32(iter, KEY_SLOTC, MODULE_STEPS);
+    dict_write_int32(iter, KEY_SLOTD, MODULE_TIMEZONE2);
+    dict_write_int32(iter, KEY_SLEEPSLOTA, MODULE_SLEEP);
+    dict_write_int32(iter, KEY_SLEEPSLOTB, MODULE_DEEP);
+    dict_write_int32(iter, KEY_SLEEPSLOTC, MODULE_WEATHER);
+    dict_write_int32(iter, KEY_SLEEPSLOTD, MODULE_FORECAST);
+    dict_write_int32(iter, KEY_HEALTHLOG, 6);
+    dict_write_int32(iter, KEY_HEALTHLOGRECORDS, 7);
+}
+
+static void write_weather(DictionaryIterator *iter, int hour) {
+    // a mild day, warmest mid afternoon
+    int temp = 8 + (hour > 15 ? 30 - hour : hour) / 2;
+    dict_write_int32(iter, KEY_TEMP, temp);
+    dict_write_int32(iter, KEY_MAX, 16);
+    dict_write_int32(iter, KEY_MIN, 4);
+    dict_write_int32(iter, KEY_WEATHER, hour % 3);
+    dict_write_int32(iter, KEY_SPEED, 12 + hour % 5);
+    dict_write_int32(iter, KEY_DIRECTION, (hour * 30) % 360);
+}
+
+static void write_update(DictionaryIterator *iter, int available) {
+    dict_write_int32(iter, KEY_HASUPDATE, available);
+}
+
+static void send_transitions(int unused) {
+    sim_send_to_watch(write_transitions_only, 0);
+}
+
+// the JS follows a config with the tables of the zones that changed, the
+// alt zone stays CET
+static void send_config(int font_type) {
+    static bool zone_sent;
+    sim_send_to_watch(write_config, font_type);
+    if (!zone_sent) {
+        zone_sent = true;
+        sim_schedule(PHONE_REPLY_MS, send_transitions, 0);
+    }
+}
+
+static void send_weather(int hour) {
+    sim_send_to_watch(write_weather, hour);
+}
+
+static void send_update(int available) {
+    sim_send_to_watch(write_update, available);
+}
+
+static void write_energy_request(DictionaryIterator *iter, int unused) {
+    dict_write_uint8(iter, KEY_DIAGNOSTICS, DIAGNOSTICS_ENERGY);
+}
+
+static uint32_t read_uint32(const uint8_t *pos) {
+    return pos[0] | pos[1] << 8 | pos[2] << 16 | (uint32_t)pos[3] << 24;
+}
+
+static void print_energy_report(const uint8_t *data, uint16_t length) {
+    static const char *names[ENERGY_EVENTS] = {
+        "msg out", "msg in", "health", "flash", "invalid", "vibes", "tick cpu"
+    };
+    if (length < 4 + ENERGY_EVENTS * 12) {
+        return;
+    }
+    uint32_t total = 0;
+    printf("energy over %u s %10s %10s %10s\n", read_uint32(data), "count", "amount", "uAh/day");
+    for (int event = 0; event < ENERGY_EVENTS; ++event) {
+        const uint8_t *pos = &data[4 + event * 12];
+        printf("%-18s %10u %10u %10u\n", names[event], read_uint32(pos), read_uint32(pos + 4), read_uint32(pos + 8));
+        total += read_uint32(pos + 8);
+    }
+    printf("%-18s %10s %10s %10u\n", "total", "", "", total);
+    energy_total = total;
+}
+
+void sim_phone_received(DictionaryIterator *iter) {
+    Tuple *energy = dict_find(iter, KEY_ENERGY);
+    if (energy) {
+        print_energy_report(energy->value->data, energy->length);
+        return;
+    }
+    if (dict_find(iter, KEY_DIAGNOSTICS) || dict_find(iter, KEY_HEALTHBATCH)) {
+        return;
+    }
+    Tuple *transitions = dict_find(iter, KEY_TZTRANSITIONS);
+    if (transitions) {
+        // JST has no DST, only the alt time gets a table
+        if (transitions->value->uint8 == 1) {
+            sim_schedule(PHONE_REPLY_MS, send_transitions, 0);
+        }
+        return;
+    }
+    if (dict_find(iter, KEY_HASUPDATE)) {
+        sim_schedule(PHONE_REPLY_MS, send_update, 0);
+        return;
+    }
+    // anything else asks for the weather
+    time_t now = time(NULL);
+    sim_schedule(PHONE_REPLY_MS, send_weather, localtime(&now)->tm_hour);
+}
+
+// Watch side
+
+static void run_minute(int minute) {
+    if (minute == CONFIG_AT) {
+        send_config(time(NULL) / SECONDS_PER_DAY % 2 ? ARCHIVO_FONT : BLOCKO_FONT);
+    }
+    if (minute == BT_DROP_START) {
+        sim_set_connected(false);
+    } else if (minute == BT_DROP_END) {
+        sim_set_connected(true);
+    }
+    #if PBL_API_EXISTS(unobstructed_area_service_subscribe)
+    if (minute == PEEK_START) {
+        sim_set_obstruction(PEEK_HEIGHT);
+    } else if (minute == PEEK_END) {
+        sim_set_obstruction(0);
+    }
+    #endif
+    if (charger && minute >= CHARGE_START && minute < CHARGE_END) {
+        if (minute == CHARGE_START || minute % 10 == 0) {
+            battery_percent = battery_percent + 10 > 100 ? 100 : battery_percent + 10;
+            sim_set_battery(battery_percent, true);
+        }
+    } else if (charger && minute == CHARGE_END) {
+        sim_set_battery(battery_percent, false);
+    } else if (minute % BATTERY_DRAIN_MINUTES == 0 && battery_percent > 0) {
+        sim_set_battery(--battery_percent, false);
+    }
+
+    #if defined(PBL_HEALTH)
+    if (minute == SLEEP_START || minute == SLEEP_END) {
+        sim_health_event(HealthEventSleepUpdate);
+    } else if (minute % 15 == 0) {
+        sim_health_event(HealthEventMovementUpdate);
+    }
+    #endif
+
+    TimeUnits units = MINUTE_UNIT;
+    if (minute % MINUTES_PER_HOUR == 0) {
+        units |= HOUR_UNIT;
+    }
+    if (minute == 0) {
+        units |= DAY_UNIT;
+    }
+    sim_tick(units);
+}
+
+static void print_header() {
+    printf("%-10s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "day",
+           "persist", "p.bytes", "msg out", "msg in", "failed",
+           "invalid", "frames", "dirty k", "paint k", "health", "snprintf", "fonts", "timers");
+}
+
+static void print_row(const char *label, const SimCounters *c) {
+    printf("%-10s %8u %8u %8u %8u %8u %8u %8u %8llu %8llu %8u %8u %8u %8u\n", label,
+           c->persist_writes, c->persist_bytes, c->messages_out, c->messages_in, c->messages_failed,
+           c->invalidations, c->frames,
+           (unsigned long long)(c->dirty_pixels / 1000), (unsigned long long)(c->painted_pixels / 1000),
+           c->health_calls, c->snprintf_calls, c->font_loads, c->timers);
+}
+
+static void add_counters(SimCounters *total, const SimCounters *day) {
+    total->persist_writes += day->persist_writes;
+    total->persist_bytes += day->persist_bytes;
+    total->messages_out += day->messages_out;
+    total->messages_in += day->messages_in;
+    total->messages_failed += day->messages_failed;
+    total->invalidations += day->invalidations;
+    total->frames += day->frames;
+    total->dirty_pixels += day->dirty_pixels;
+    total->painted_pixels += day->painted_pixels;
+    total->health_calls += day->health_calls;
+    total->snprintf_calls += day->snprintf_calls;
+    total->font_loads += day->font_loads;
+    total->timers += day->timers;
+    total->text_overlaps += day->text_overlaps;
+    total->logs += day->logs;
+}
+
+void sim_event_loop() {
+    SimCounters *total = &week;
+
+    // the first configuration arrives right after install
+    sim_schedule(5 * 1000, send_config, BLOCKO_FONT);
+
+    print_header();
+    for (int day = 0; day < days; ++day) {
+        for (int minute = 0; minute < MINUTES_PER_DAY; ++minute) {
+            time_t at = start_time + ((time_t)day * MINUTES_PER_DAY + minute) * SECONDS_PER_MINUTE;
+            sim_run_until((uint64_t)at * 1000);
+            if (day == 0 && minute == 0) {
+                continue; // launched on the minute, the tick is the next one
+            }
+            run_minute(minute);
+            sim_render();
+        }
+        char label[16];
+        time_t day_start = start_time + (time_t)day * SECONDS_PER_DAY;
+        strftime(label, sizeof(label), "%a %d", localtime(&day_start));
+        print_row(label, &sim_counters);
+        add_counters(total, &sim_counters);
+        memset(&sim_counters, 0, sizeof(sim_counters));
+    }
+    print_row("total", total);
+    sim_print_screen_report();
+    printf("text: %u frames with rows overlapping or cut by the peek\n", total->text_overlaps);
+    if (heatmap_dir && sim_write_heatmaps(heatmap_dir)) {
+        printf("heatmaps written to %s\n", heatmap_dir);
+    }
+    printf("scheduler: %d batches over budget, %d runs deferred, runs", get_batch_overruns(), get_deferred_runs());
+    for (int task = 0; task < TASK_COUNT; ++task) {
+        printf(" %d", get_task_runs(task));
+    }
+    printf("\n");
+    sim_send_to_watch(write_energy_request, 0);
+    sim_run_until(sim_now_ms() + PHONE_REPLY_MS);
+}
+
+// Baseline
+
+// the costs, then how the week was scheduled: the batches that ran out of
+// budget, the runs they deferred to a later slice and the runs of each task
+#define SCHEDULING_VALUES 16
+#define BASELINE_VALUES (SCHEDULING_VALUES + 2 + TASK_COUNT)
+
+static const char *const baseline_names[BASELINE_VALUES] = {
+    "days", "persist", "p.bytes", "msg out", "msg in", "failed", "invalid", "frames",
+    "dirty", "paint", "health", "snprintf", "fonts", "timers", "energy", "overlaps",
+    "overruns", "deferred", "runs sleep status", "runs power", "runs update check", "runs sleep data",
+    "runs wake window", "runs weather", "runs health", "runs health log"
+};
+
+static void baseline_values(uint64_t *values) {
+    const SimCounters *c = &week;
+    uint64_t all[BASELINE_VALUES] = {
+        days, c->persist_writes, c->persist_bytes, c->messages_out, c->messages_in, c->messages_failed,
+        c->invalidations, c->frames, c->dirty_pixels, c->painted_pixels,
+        c->health_calls, c->snprintf_calls, c->font_loads, c->timers, energy_total, c->text_overlaps,
+        get_batch_overruns(), get_deferred_runs()
+    };
+    for (int task = 0; task < TASK_COUNT; ++task) {
+        all[SCHEDULING_VALUES + 2 + task] = get_task_runs(task);
+    }
+    memcpy(values, all, sizeof(all));
+}
+
+static bool write_baseline(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "hostsim: can't write %s\n", path);
+        return false;
+    }
+    uint64_t values[BASELINE_VALUES];
+    baseline_values(values);
+    fprintf(f, "# totals of the simulated week, checked by make -C tools/hostsim check\n");
+    for (int i = 0; i < BASELINE_VALUES; ++i) {
+        fprintf(f, "%s=%llu\n", baseline_names[i], (unsigned long long)values[i]);
+    }
+    fclose(f);
+    printf("baseline written to %s\n", path);
+    return true;
+}
+
+// every cost must be at most the baseline, the run length and the
+// scheduling exactly: a deferred run still has to happen
+static bool check_baseline(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "hostsim: can't read %s\n", path);
+        return false;
+    }
+    uint64_t values[BASELINE_VALUES];
+    baseline_values(values);
+    bool passed = true;
+    bool improved = false;
+    int found = 0;
+    char line[64];
+    while (fgets(line, sizeof(line), f)) {
+        char *value = strchr(line, '=');
+        if (line[0] == '#' || !value) {
+            continue;
+        }
+        *value++ = '\0';
+        unsigned long long expected = strtoull(value, NULL, 10);
+        int i = 0;
+        while (i < BASELINE_VALUES && strcmp(line, baseline_names[i]) != 0) {
+            i++;
+        }
+        if (i == BASELINE_VALUES) {
+            fprintf(stderr, "hostsim: unknown baseline value %s\n", line);
+            passed = false;
+            continue;
+        }
+        found++;
+        bool exact = i == 0 || i >= SCHEDULING_VALUES;
+        if (exact ? values[i] != expected : values[i] > expected) {
+            printf("%s: %s %llu, baseline %llu\n", exact ? "changed" : "regression",
+                   baseline_names[i], (unsigned long long)values[i], expected);
+            passed = false;
+        } else if (values[i] < expected) {
+            improved = true;
+        }
+    }
+    fclose(f);
+    if (found != BASELINE_VALUES) {
+        fprintf(stderr, "hostsim: %s has %d of %d values\n", path, found, BASELINE_VALUES);
+        passed = false;
+    }
+    if (passed) {
+        printf("baseline %s: ok%s\n", path, improved ? ", improved, update it with make baseline" : "");
+    }
+    return passed;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-d days] [-s YYYY-MM-DD] [-b battery%%] [-n] [-p state] [-o dir] [-f] [-v] [-c|-w baseline]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    struct tm start = { .tm_year = 2026 - 1900, .tm_mon = 0, .tm_mday = 5 }; // a Monday
+    const char *state = NULL;
+    const char *check_path = NULL;
+    const char *write_path = NULL;
+    int opt;
+
+    setenv("TZ", "UTC", 0);
+    tzset();
+
+    while ((opt = getopt(argc, argv, "d:s:b:np:o:fvc:w:")) != -1) {
+        switch (opt) {
+            case 'd':
+                days = atoi(optarg);
+                break;
+            case 's':
+                if (!strptime(optarg, "%Y-%m-%d", &start)) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'b':
+                battery_percent = atoi(optarg);
+                break;
+            case 'n':
+                charger = false; // never charged, to reach the low battery profiles
+                break;
+            case 'p':
+                state = optarg; // launched again from the storage the last run left
+                break;
+            case 'o':
+                heatmap_dir = optarg;
+                break;
+            case 'f':
+                sim_trace_frames = true;
+                break;
+            case 'v':
+                sim_verbose = true;
+                break;
+            case 'c':
+                check_path = optarg;
+                break;
+            case 'w':
+                write_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    start.tm_isdst = -1;
+    start_time = mktime(&start);
+    sim_set_clock(start_time);
+    sim_set_battery(battery_percent, false);
+    if (state) {
+        sim_load_persist(state);
+    }
+    timeboxed_main();
+    if (state) {
+        sim_save_persist(state);
+    }
+    if (write_path && !write_baseline(write_path)) {
+        return 1;
+    }
+    if (check_path && !check_baseline(check_path)) {
+        return 1;
+    }
+    return 0;
+}
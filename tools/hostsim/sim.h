@@ -0,0 +1,71 @@
+// Interface between the emulated SDK (pebble_stub.c) and the scenario
+// driver (sim.c).
+#ifndef __HOSTSIM_SIM_
+#define __HOSTSIM_SIM_
+
+#include <pebble.h>
+
+typedef struct {
+    uint32_t persist_writes;
+    uint32_t persist_bytes;
+    uint32_t messages_out;
+    uint32_t messages_in;
+    uint32_t messages_failed;
+    uint32_t invalidations;
+    uint32_t frames;
+    uint64_t dirty_pixels; // a few billion a month on chalk
+    uint64_t painted_pixels;
+    uint32_t health_calls;
+    uint32_t snprintf_calls;
+    uint32_t font_loads;
+    uint32_t timers;
+    uint32_t text_overlaps; // frames with text rows overlapping or cut by the obstruction
+    uint32_t logs;
+} SimCounters;
+
+typedef void (*SimEventCallback)(int arg);
+typedef void (*SimDictBuilder)(DictionaryIterator *iter, int arg);
+
+// counters of the current simulated day, reset by the driver
+extern SimCounters sim_counters;
+extern bool sim_verbose;
+// prints the dirty rectangles and pixel counts of every frame
+extern bool sim_trace_frames;
+
+// virtual clock, in milliseconds since the epoch
+uint64_t sim_now_ms();
+void sim_set_clock(time_t start);
+
+// runs every app timer and scheduled event up to the given time, then
+// renders a frame if anything was invalidated
+void sim_run_until(uint64_t until_ms);
+void sim_schedule(uint32_t delay_ms, SimEventCallback callback, int arg);
+void sim_render();
+
+// screen cost over the whole run: averages per frame, and heatmaps of how
+// often each pixel was invalidated and how many layers painted it
+void sim_print_screen_report();
+bool sim_write_heatmaps(const char *dir);
+
+// persistent storage from and to a state file, for warm launches
+bool sim_load_persist(const char *path);
+void sim_save_persist(const char *path);
+
+// emulated services, driven by the scenario
+void sim_tick(TimeUnits units_changed);
+void sim_set_connected(bool connected);
+bool sim_is_connected();
+void sim_set_battery(uint8_t percent, bool charging);
+void sim_send_to_watch(SimDictBuilder builder, int arg);
+// slides a Quick View peek of the given height in or, with 0, out
+void sim_set_obstruction(int16_t height);
+#if defined(PBL_HEALTH)
+void sim_health_event(HealthEventType event);
+#endif
+
+// implemented by the scenario: what the phone does with an outgoing
+// message, and the health model the health service reports from
+void sim_phone_received(DictionaryIterator *iter);
+bool sim_is_asleep(time_t when);
+
+#endif
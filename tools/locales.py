@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+"""
+Packs the weekday and month names of resources/data/locales.txt into the
+LOCALES raw resource, resources/data/locales.bin.
+
+Each locale is a fixed size record of LOCALE_NAMES names, LOCALE_NAME_LEN
+bytes each and NUL padded, so the watch loads only the selected one with a
+single resource_load_byte_range. Both constants must match src/locales.c.
+
+Usage: python tools/locales.py [--check]
+"""
+
+from __future__ import print_function
+
+import io
+import os
+import sys
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+SOURCE = os.path.join(ROOT, 'resources', 'data', 'locales.txt')
+PACK = os.path.join(ROOT, 'resources', 'data', 'locales.bin')
+
+LOCALE_NAMES = 7 + 12
+LOCALE_NAME_LEN = 4
+
+
+def read_table():
+    """Returns (code, names) for each locale, in LC_* order."""
+    locales = []
+    with io.open(SOURCE, encoding='utf-8') as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split('#', 1)[0].split()
+            if not fields:
+                continue
+            code, names = fields[0], fields[1:]
+            if len(names) != LOCALE_NAMES:
+                raise SystemExit('{}:{}: {} has {} names, expected {}'.format(
+                    SOURCE, number, code, len(names), LOCALE_NAMES))
+            locales.append((code, names))
+    return locales
+
+
+def pack(locales):
+    data = bytearray()
+    for code, names in locales:
+        for name in names:
+            encoded = name.encode('utf-8')
+            if len(encoded) >= LOCALE_NAME_LEN:
+                raise SystemExit('{}: "{}" needs more than {} bytes'.format(code, name, LOCALE_NAME_LEN - 1))
+            data += encoded + b'\0' * (LOCALE_NAME_LEN - len(encoded))
+    return bytes(data)
+
+
+def main(argv):
+    check = '--check' in argv
+    data = pack(read_table())
+
+    current = None
+    if os.path.exists(PACK):
+        with open(PACK, 'rb') as f:
+            current = f.read()
+
+    if check:
+        if current != data:
+            print('resources/data/locales.bin is out of date, run tools/locales.py')
+            return 1
+        return 0
+
+    if current != data:
+        with open(PACK, 'wb') as f:
+            f.write(data)
+        print('Packed {} locales, {} bytes each'.format(len(data) // (LOCALE_NAMES * LOCALE_NAME_LEN),
+                                                        LOCALE_NAMES * LOCALE_NAME_LEN))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,145 @@
+#!/usr/bin/env python
+"""
+Reports the .text, .rodata, .data and .bss bytes of each object file of the
+face, so RAM regressions show up in the build output.
+
+Pebble loads the whole app image into the app's RAM, so .rodata is not free
+either, but .data and .bss are what grows with every mutable table or buffer
+and .data additionally holds the relocated pointer tables (.data.rel.ro on
+the host). COMMON symbols are counted as .bss.
+
+Reads ELF32 and ELF64 objects of either endianness, no binutils needed.
+
+Usage: python tools/sections.py [--totals] <object or directory>...
+"""
+
+from __future__ import print_function
+
+import os
+import struct
+import sys
+
+COLUMNS = ('text', 'rodata', 'data', 'bss')
+
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+SHN_COMMON = 0xfff2
+
+
+def section_kind(name, flags, section_type):
+    if not flags & SHF_ALLOC:
+        return None
+    if section_type == SHT_NOBITS or name.startswith(('.bss', '.sbss')):
+        return 'bss'
+    if name.startswith('.text'):
+        return 'text'
+    if name.startswith('.rodata'):
+        return 'rodata'
+    if name.startswith(('.data', '.sdata')):
+        return 'data'
+    return None
+
+
+def read_sizes(path):
+    """Returns {column: bytes} of one relocatable ELF object."""
+    with open(path, 'rb') as f:
+        image = f.read()
+    if image[:4] != b'\x7fELF':
+        raise ValueError('{}: not an ELF file'.format(path))
+    wide = bytearray(image)[4] == 2
+    order = '<' if bytearray(image)[5] == 1 else '>'
+
+    if wide:
+        shoff, = struct.unpack_from(order + 'Q', image, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + 'HHH', image, 0x3a)
+        header = order + 'IIQQQQIIQQ'
+    else:
+        shoff, = struct.unpack_from(order + 'I', image, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + 'HHH', image, 0x2e)
+        header = order + 'IIIIIIIIII'
+
+    # name, type, flags, addr, offset, size, link, info, addralign, entsize
+    sections = [struct.unpack_from(header, image, shoff + i * shentsize) for i in range(shnum)]
+    names = sections[shstrndx][4]
+
+    def string_at(offset):
+        return image[offset:image.index(b'\0', offset)].decode('ascii', 'replace')
+
+    sizes = dict((column, 0) for column in COLUMNS)
+    for name, section_type, flags, _, offset, size, link, _, _, entsize in sections:
+        kind = section_kind(string_at(names + name), flags, section_type)
+        if kind:
+            sizes[kind] += size
+        if section_type == SHT_SYMTAB:
+            sizes['bss'] += common_bytes(image, order, wide, offset, size, entsize)
+    return sizes
+
+
+def common_bytes(image, order, wide, offset, size, entsize):
+    # uninitialised globals of -fcommon objects only get their space at link
+    total = 0
+    for position in range(offset, offset + size, entsize):
+        if wide:
+            _, _, _, shndx, _, value_size = struct.unpack_from(order + 'IBBHQQ', image, position)
+        else:
+            _, _, value_size, _, _, shndx = struct.unpack_from(order + 'IIIBBH', image, position)
+        if shndx == SHN_COMMON:
+            total += value_size
+    return total
+
+
+def find_objects(paths):
+    objects = []
+    for path in paths:
+        if os.path.isdir(path):
+            for directory, _, files in os.walk(path):
+                objects.extend(os.path.join(directory, f) for f in files if f.endswith('.o'))
+        else:
+            objects.append(path)
+    return sorted(objects)
+
+
+def object_name(path):
+    # waf names them src/foo.c.1.o, make out/<platform>/app/foo.o
+    name = os.path.basename(path)
+    return name.split('.c.')[0] if '.c.' in name else name[:-2]
+
+
+def report(paths, title=None, totals_only=False):
+    objects = find_objects(paths)
+    if not objects:
+        return None
+    totals = dict((column, 0) for column in COLUMNS)
+    lines = []
+    for path in objects:
+        sizes = read_sizes(path)
+        for column in COLUMNS:
+            totals[column] += sizes[column]
+        lines.append((object_name(path), sizes))
+
+    row = '{:<14}' + '{:>8}' * (len(COLUMNS) + 1)
+    if title:
+        print(title)
+    print(row.format('', *(COLUMNS + ('ram',))))
+    if not totals_only:
+        for name, sizes in lines:
+            print(row.format(name, *([sizes[c] for c in COLUMNS] + [sizes['data'] + sizes['bss']])))
+    print(row.format('total', *([totals[c] for c in COLUMNS] + [totals['data'] + totals['bss']])))
+    return totals
+
+
+def main(argv):
+    totals_only = '--totals' in argv
+    paths = [arg for arg in argv if not arg.startswith('--')]
+    if not paths:
+        print(__doc__.strip())
+        return 2
+    if report(paths, totals_only=totals_only) is None:
+        print('no object files under {}'.format(' '.join(paths)))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))